@@ -0,0 +1,492 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#include <QtWidgets/QtWidgets>
+#include <Presentation.hpp>
+#include <PresentationSlideView.hpp>
+#include <PresentationWindow.hpp>
+#include <SlideTransition.hpp>
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+struct BenchmarkScenario
+{
+public:
+    int Slides;
+    int ImagesPerSlide;
+    QSize ImageSize;
+};
+
+struct BenchmarkResult
+{
+public:
+    QString Metric;
+    std::vector<double> Samples;
+};
+
+static const int MaxImageAssets = 32;
+static const int WaitTimeoutMs = 30000;
+
+static double PeakRSSMiB(){
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+    return 0.0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+// ru_maxrss and PeakWorkingSetSize are high-water marks of the whole process,
+// so per-mode figures come from a fresh child process per load.
+static int RunLoadChild(const QString& path, const QString& mode){
+    try{
+        if(mode == "eager"){
+            Presentation presentation(path, PresentationLoadMode::eager);
+        }
+        else if(mode == "lazy"){
+            Presentation presentation(path, PresentationLoadMode::lazy);
+            std::shared_ptr<PresentationLoadProgress> progress = presentation.LoadProgress();
+            while(!progress->Finished.load())
+                QThread::msleep(1);
+        }
+        else if(mode == "streaming"){
+            Presentation presentation(path, PresentationLoadMode::streaming);
+        }
+        else if(mode != "none"){
+            return 2;
+        }
+    }
+    catch(PresentationException& e){
+        fprintf(stderr, "[ERROR] %s\n", e.what());
+        return 1;
+    }
+    printf("%.1f\n", PeakRSSMiB());
+    return 0;
+}
+
+static double MeasureLoadRSS(const QString& path, const QString& mode){
+    QProcess process;
+    process.start(QCoreApplication::applicationFilePath(), { "--load-rss", path, "--load-mode", mode });
+    if(!process.waitForFinished(WaitTimeoutMs * 10) || process.exitStatus() != QProcess::NormalExit || process.exitCode())
+        return -1.0;
+    return process.readAllStandardOutput().trimmed().toDouble();
+}
+
+static double Percentile(std::vector<double> samples, double percentile){
+    if(samples.empty())
+        return 0.0;
+    std::sort(samples.begin(), samples.end());
+    size_t rank = (size_t)std::ceil(percentile * samples.size());
+    return samples[std::min(samples.size() - 1, rank ? rank - 1 : 0)];
+}
+
+static double ElapsedMs(const QElapsedTimer& timer){
+    return timer.nsecsElapsed() / 1000000.0;
+}
+
+static int AssetCount(const BenchmarkScenario& scenario){
+    return qMin(scenario.Slides * scenario.ImagesPerSlide, MaxImageAssets);
+}
+
+static QString AssetName(int asset){
+    return QString("image%1.jpg").arg(asset);
+}
+
+static QByteArray GenerateImage(const QSize& size, int seed){
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0, QColor::fromHsv((seed * 37) % 360, 200, 230));
+    gradient.setColorAt(1, QColor::fromHsv((seed * 37 + 120) % 360, 160, 90));
+    painter.fillRect(image.rect(), gradient);
+    painter.setPen(Qt::white);
+    for(int i = 0; i < 64; i++)
+        painter.drawLine(0, i * size.height() / 64, size.width(), (63 - i) * size.height() / 64);
+    painter.end();
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "JPG", 90);
+    return data;
+}
+
+static QByteArray GenerateMainXML(const BenchmarkScenario& scenario){
+    QByteArray xml = "<Presentation Title=\"Benchmark\">\n";
+    int assets = AssetCount(scenario);
+    int columns = qMax(1, (int)std::ceil(std::sqrt((double)scenario.ImagesPerSlide)));
+    int cell = 100 / columns;
+    for(int slide = 0; slide < scenario.Slides; slide++){
+        xml += "<Slide Title=\"Slide " + QByteArray::number(slide + 1) + "\">\n";
+        xml += "<SlideBackground><Color><R>30</R><G>30</G><B>40</B></Color></SlideBackground>\n";
+        for(int i = 0; i < scenario.ImagesPerSlide; i++){
+            int asset = (slide * scenario.ImagesPerSlide + i) % assets;
+            xml += "<Image Filename=\"" + AssetName(asset).toUtf8() + "\"><Alt>Image</Alt>";
+            xml += "<Size><Width>" + QByteArray::number(cell) + "%</Width><Height>" + QByteArray::number(cell) + "%</Height></Size>";
+            xml += "<Position><X>" + QByteArray::number(cell / 2 + (i % columns) * cell) + "%</X>";
+            xml += "<Y>" + QByteArray::number(100 - cell / 2 - (i / columns) * cell) + "%</Y></Position></Image>\n";
+        }
+        for(int i = 0; i < 3; i++){
+            xml += "<Text String=\"Slide " + QByteArray::number(slide + 1) + " text box " + QByteArray::number(i + 1) +
+                   "\\nwith a second line of benchmark text\">";
+            xml += "<Position><X>50%</X><Y>" + QByteArray::number(80 - i * 30) + "%</Y></Position>";
+            xml += "<Size><Width>90%</Width><Height>20%</Height></Size>";
+            xml += "<Font><Size>" + QByteArray::number(10 - i * 2) + "pt</Size><Color><R>255</R><G>255</G><B>255</B></Color></Font>";
+            xml += "<Alignment><Horizontal>center</Horizontal><Vertical>center</Vertical></Alignment></Text>\n";
+        }
+        xml += "</Slide>\n";
+    }
+    xml += "</Presentation>\n";
+    return xml;
+}
+
+static bool AddEntry(zip_t* archive, const char* name, const QByteArray& data, bool store){
+    zip_source_t* source = zip_source_buffer(archive, data.constData(), data.size(), 0);
+    if(!source)
+        return false;
+    zip_int64_t index = zip_file_add(archive, name, source, ZIP_FL_OVERWRITE);
+    if(index < 0){
+        zip_source_free(source);
+        return false;
+    }
+    if(store)
+        zip_set_file_compression(archive, index, ZIP_CM_STORE, 0);
+    return true;
+}
+
+static bool WriteArchive(const QString& path, const BenchmarkScenario& scenario){
+    int error = 0;
+    zip_t* archive = zip_open(path.toUtf8().constData(), ZIP_CREATE | ZIP_TRUNCATE, &error);
+    if(!archive)
+        return false;
+    // libzip reads the buffers on zip_close, so they have to outlive it.
+    std::vector<QByteArray> buffers;
+    buffers.push_back(GenerateMainXML(scenario));
+    bool ok = AddEntry(archive, "main.xml", buffers.back(), false);
+    for(int asset = 0; ok && asset < AssetCount(scenario); asset++){
+        buffers.push_back(GenerateImage(scenario.ImageSize, asset));
+        ok = AddEntry(archive, AssetName(asset).toUtf8().constData(), buffers.back(), true);
+    }
+    if(!ok){
+        zip_discard(archive);
+        return false;
+    }
+    return zip_close(archive) == 0;
+}
+
+static bool WaitFor(const std::function<bool()>& condition){
+    QTimer wakeUp;
+    wakeUp.start(5);
+    QElapsedTimer timeout;
+    timeout.start();
+    while(!condition()){
+        if(timeout.elapsed() > WaitTimeoutMs)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+static void Idle(int ms){
+    QElapsedTimer timer;
+    timer.start();
+    while(timer.elapsed() < ms)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, ms - timer.elapsed());
+}
+
+static void ClearModelCache(){
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/slides").removeRecursively();
+}
+
+static void MeasureLoad(const QString& path, const BenchmarkScenario& scenario, std::vector<BenchmarkResult>* results){
+    int iterations = scenario.Slides >= 1000 ? 3 : 10;
+    BenchmarkResult eager = { "Presentation (eager)", {} };
+    BenchmarkResult lazy = { "Presentation (lazy)", {} };
+    BenchmarkResult streaming = { "Presentation (streaming)", {} };
+    BenchmarkResult cold = { "Presentation (model cache cold)", {} };
+    BenchmarkResult warm = { "Presentation (model cache warm)", {} };
+    for(int i = 0; i < iterations; i++){
+        QElapsedTimer timer;
+        timer.start();
+        {
+            Presentation presentation(path, PresentationLoadMode::eager);
+            eager.Samples.push_back(ElapsedMs(timer));
+        }
+        timer.restart();
+        {
+            Presentation presentation(path, PresentationLoadMode::lazy);
+            lazy.Samples.push_back(ElapsedMs(timer));
+        }
+        timer.restart();
+        {
+            Presentation presentation(path, PresentationLoadMode::streaming);
+            streaming.Samples.push_back(ElapsedMs(timer));
+        }
+        ClearModelCache();
+        timer.restart();
+        {
+            Presentation presentation(path, PresentationLoadMode::eager, true);
+            cold.Samples.push_back(ElapsedMs(timer));
+        }
+        timer.restart();
+        {
+            Presentation presentation(path, PresentationLoadMode::eager, true);
+            warm.Samples.push_back(ElapsedMs(timer));
+        }
+    }
+    ClearModelCache();
+    results->push_back(eager);
+    results->push_back(lazy);
+    results->push_back(streaming);
+    results->push_back(cold);
+    results->push_back(warm);
+}
+
+static void MeasureGetImage(Presentation* presentation, const BenchmarkScenario& scenario, std::vector<BenchmarkResult>* results){
+    if(!AssetCount(scenario))
+        return;
+    BenchmarkResult cold = { "GetImage (cold)", {} };
+    BenchmarkResult warm = { "GetImage (cached)", {} };
+    presentation->SetImageCacheBudget(0);
+    for(int asset = 0; asset < AssetCount(scenario); asset++){
+        QElapsedTimer timer;
+        timer.start();
+        presentation->GetImage(AssetName(asset));
+        cold.Samples.push_back(ElapsedMs(timer));
+    }
+    presentation->SetImageCacheBudget(1024LL * 1024 * 1024);
+    for(int asset = 0; asset < AssetCount(scenario); asset++){
+        presentation->GetImage(AssetName(asset));
+        QElapsedTimer timer;
+        timer.start();
+        presentation->GetImage(AssetName(asset));
+        warm.Samples.push_back(ElapsedMs(timer));
+    }
+    results->push_back(cold);
+    results->push_back(warm);
+}
+
+static void MeasureSetSlide(Presentation* presentation, std::vector<BenchmarkResult>* results){
+    BenchmarkResult setSlide = { "setSlide", {} };
+    BenchmarkResult ready = { "setSlide until rendered", {} };
+    PresentationSlideView view;
+    view.setGeometry(0, 0, 1920, 1080);
+    bool rendered = false;
+    QObject::connect(&view, &PresentationSlideView::frameRendered, [&rendered](unsigned int, const QImage&){ rendered = true; });
+    unsigned int samples = (unsigned int)qMin<size_t>(presentation->SlideCount(), 50);
+    for(unsigned int i = 0; i < samples; i++){
+        rendered = false;
+        QElapsedTimer timer;
+        timer.start();
+        view.setSlide(presentation, i);
+        setSlide.Samples.push_back(ElapsedMs(timer));
+        if(WaitFor([&rendered](){ return rendered; }))
+            ready.Samples.push_back(ElapsedMs(timer));
+    }
+    results->push_back(setSlide);
+    results->push_back(ready);
+}
+
+static void MeasureNextSlide(const QString& path, std::vector<BenchmarkResult>* results){
+    BenchmarkResult backToBack = { "next slide (back-to-back)", {} };
+    BenchmarkResult prefetched = { "next slide (after idle)", {} };
+    Presentation* presentation = new Presentation(path, PresentationLoadMode::lazy);
+    PresentationWindow* window = new PresentationWindow();
+    unsigned int shown = 0;
+    bool hasShown = false;
+    QObject::connect(window, &PresentationWindow::slideShown, [&shown, &hasShown](unsigned int index){ shown = index; hasShown = true; });
+    // Times the switch itself; transitions are measured on their own below.
+    window->setTransition(cut);
+    window->setPresentation(presentation);
+    QAction* nextAction = nullptr;
+    for(QAction* action : window->actions()){
+        if(action->shortcuts().contains(QKeySequence(Qt::Key_Right)))
+            nextAction = action;
+    }
+    unsigned int transitions = (unsigned int)qMin<size_t>(presentation->SlideCount() - 1, 100);
+    for(unsigned int i = 1; nextAction && i <= transitions; i++){
+        bool idle = i % 2 == 0;
+        if(idle)
+            Idle(50);
+        hasShown = false;
+        QElapsedTimer timer;
+        timer.start();
+        nextAction->trigger();
+        if(!WaitFor([&shown, &hasShown, i](){ return hasShown && shown == i; }))
+            break;
+        window->repaint();
+        (idle ? prefetched : backToBack).Samples.push_back(ElapsedMs(timer));
+    }
+    delete window;
+    results->push_back(backToBack);
+    results->push_back(prefetched);
+}
+
+static void MeasureTransitions(const QSize& size, std::vector<BenchmarkResult>* results){
+    QImage from(size, QImage::Format_ARGB32_Premultiplied);
+    QImage to(size, QImage::Format_ARGB32_Premultiplied);
+    QImage frame(size, QImage::Format_ARGB32_Premultiplied);
+    from.fill(QColor::fromRgb(30, 30, 40));
+    to.fill(QColor::fromRgb(230, 200, 120));
+    const SlideTransitionType types[] = { crossfade, push, wipe };
+    const char* names[] = { "crossfade", "push", "wipe" };
+    const int frames = 60;
+    for(int t = 0; t < 3; t++){
+        BenchmarkResult result = { QString("%1 frame %2x%3").arg(names[t]).arg(size.width()).arg(size.height()), {} };
+        for(int i = 0; i <= frames; i++){
+            QElapsedTimer timer;
+            timer.start();
+            SlideTransition::composite(types[t], from, to, (qreal)i / frames, false, &frame);
+            result.Samples.push_back(ElapsedMs(timer));
+        }
+        results->push_back(result);
+    }
+}
+
+static void PrintTable(const std::vector<BenchmarkResult>& results){
+    printf("  %-28s %8s %12s %12s\n", "metric", "samples", "p50 (ms)", "p99 (ms)");
+    for(const BenchmarkResult& result : results){
+        if(result.Samples.empty())
+            continue;
+        printf("  %-28s %8zu %12.3f %12.3f\n", result.Metric.toStdString().c_str(), result.Samples.size(),
+               Percentile(result.Samples, 0.5), Percentile(result.Samples, 0.99));
+    }
+}
+
+static void PrintResults(const BenchmarkScenario& scenario, const std::vector<BenchmarkResult>& results,
+                         const QString& path){
+    printf("\n%d slides, %d images/slide, %dx%d images\n", scenario.Slides, scenario.ImagesPerSlide,
+           scenario.ImageSize.width(), scenario.ImageSize.height());
+    PrintTable(results);
+    for(const char* mode : { "none", "eager", "lazy", "streaming" }){
+        double rss = MeasureLoadRSS(path, mode);
+        QString metric = QString("peak RSS (load %1)").arg(mode);
+        if(rss < 0)
+            printf("  %-28s %8s %12s\n", metric.toStdString().c_str(), "", "failed");
+        else
+            printf("  %-28s %8s %12.1f MiB\n", metric.toStdString().c_str(), "", rss);
+    }
+    printf("  %-28s %8s %12.1f MiB\n", "peak RSS (all so far)", "", PeakRSSMiB());
+    fflush(stdout);
+}
+
+static bool RunScenario(const QTemporaryDir& directory, const BenchmarkScenario& scenario){
+    QString path = directory.filePath(QString("bench-%1-%2-%3.spres").arg(scenario.Slides).arg(scenario.ImagesPerSlide)
+                                      .arg(scenario.ImageSize.width()));
+    if(!WriteArchive(path, scenario)){
+        fprintf(stderr, "[ERROR] Failed to write %s\n", path.toStdString().c_str());
+        return false;
+    }
+    std::vector<BenchmarkResult> results;
+    try{
+        MeasureLoad(path, scenario, &results);
+        Presentation presentation(path, PresentationLoadMode::eager);
+        MeasureGetImage(&presentation, scenario, &results);
+        MeasureSetSlide(&presentation, &results);
+        MeasureNextSlide(path, &results);
+    }
+    catch(PresentationException& e){
+        fprintf(stderr, "[ERROR] %s\n", e.what());
+        return false;
+    }
+    PrintResults(scenario, results, path);
+    QFile::remove(path);
+    return true;
+}
+
+int main(int argc, char* argv[]){
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    // Keeps the model cache files written by the load benchmark out of the
+    // user's real cache directory.
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Load, parse, decode and slide-switch benchmarks for Simple Press 2.");
+    parser.addHelpOption();
+    QCommandLineOption slidesOption("slides", "Run a single scenario with <n> slides.", "n");
+    QCommandLineOption imagesOption("images", "Images per slide for the single scenario.", "n", "0");
+    QCommandLineOption imageSizeOption("image-size", "Image size for the single scenario.", "WxH", "640x360");
+    QCommandLineOption loadRSSOption("load-rss", "Internal: load <deck> once and print the peak RSS in MiB.", "deck");
+    QCommandLineOption loadModeOption("load-mode", "Internal: load mode for --load-rss.", "mode", "none");
+    loadRSSOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    loadModeOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOptions({ slidesOption, imagesOption, imageSizeOption, loadRSSOption, loadModeOption });
+    parser.process(app);
+    if(parser.isSet(loadRSSOption))
+        return RunLoadChild(parser.value(loadRSSOption), parser.value(loadModeOption));
+
+    std::vector<BenchmarkScenario> scenarios;
+    if(parser.isSet(slidesOption)){
+        QStringList size = parser.value(imageSizeOption).toLower().split('x');
+        BenchmarkScenario scenario = { parser.value(slidesOption).toInt(), parser.value(imagesOption).toInt(),
+                                       size.size() == 2 ? QSize(size[0].toInt(), size[1].toInt()) : QSize() };
+        if(scenario.Slides < 1 || scenario.ImagesPerSlide < 0 || (scenario.ImagesPerSlide && scenario.ImageSize.isEmpty())){
+            fprintf(stderr, "[ERROR] Invalid scenario.\n");
+            return 2;
+        }
+        scenarios.push_back(scenario);
+    }
+    else{
+        scenarios = {
+            { 10, 0, QSize() },
+            { 1000, 0, QSize() },
+            { 10000, 0, QSize() },
+            { 100, 10, QSize(256, 256) },
+            { 100, 100, QSize(256, 256) },
+            { 1000, 10, QSize(640, 360) },
+            { 10, 1, QSize(1920, 1080) },
+            { 10, 1, QSize(3840, 2160) },
+            { 10, 1, QSize(7680, 4320) },
+        };
+    }
+
+    QTemporaryDir directory;
+    if(!directory.isValid()){
+        fprintf(stderr, "[ERROR] Could not create temporary directory.\n");
+        return 1;
+    }
+    int failures = 0;
+    for(const BenchmarkScenario& scenario : scenarios){
+        if(!RunScenario(directory, scenario))
+            failures++;
+    }
+    std::vector<BenchmarkResult> transitions;
+    MeasureTransitions(QSize(1920, 1080), &transitions);
+    MeasureTransitions(QSize(3840, 2160), &transitions);
+    printf("\nslide transitions (budget 16.7 ms at 60 fps, 33.3 ms at 30 fps)\n");
+    PrintTable(transitions);
+    fflush(stdout);
+    return failures ? 1 : 0;
+}
@@ -20,6 +20,7 @@
 #include <QtGui/QFileOpenEvent>
 #include <MainWindow.hpp>
 #include <PresentationWindow.hpp>
+#include <PresentationLoader.hpp>
 
 class Application : public QApplication
 {
@@ -29,6 +30,12 @@ public:
 
     bool event(QEvent *event) override;
     int Execute();
+    void OpenPresentation(const QString& FilePath);
     MainWindow *mainWindow = nullptr;
     PresentationWindow *presentationWindow = nullptr;
+private:
+    void ShowPresentation(Presentation* Pres, const QString& FilePath);
+    void ShowLoadError(const QString& Error);
+private:
+    QPointer<PresentationLoader> m_presentationLoader;
 };
\ No newline at end of file
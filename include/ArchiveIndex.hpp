@@ -0,0 +1,59 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <vector>
+#ifdef __APPLE__
+#include <vendor/libzip/zip.h>
+#else
+#include <zip.h>
+#endif
+
+struct ArchiveEntry
+{
+public:
+    QString Name;
+    zip_uint64_t Index = 0;
+    zip_uint64_t Valid = 0;
+    quint64 Size = 0;
+    quint64 CompressedSize = 0;
+    quint32 Crc = 0;
+    quint16 CompressionMethod = 0;
+    quint16 EncryptionMethod = 0;
+    qint64 LocalHeaderOffset = -1;
+};
+
+// Snapshot of the central directory taken once at open, so lookups by name
+// are a hash probe instead of libzip's linear ZIP_FL_NOCASE scan.
+class ArchiveIndex
+{
+public:
+    ArchiveIndex() = default;
+    bool build(struct zip* archive, const uchar* data = nullptr, qint64 dataSize = 0);
+    const ArchiveEntry* find(const QString& name) const;
+    bool sameEntry(const ArchiveIndex& other, const QString& name) const;
+    inline size_t size() const { return m_entries.size(); };
+    inline const std::vector<ArchiveEntry>& entries() const { return m_entries; };
+    static qint64 dataOffset(const uchar* data, qint64 dataSize, const ArchiveEntry& entry);
+private:
+    static QString key(const QString& name);
+    void readLocalHeaderOffsets(const uchar* data, qint64 dataSize);
+private:
+    std::vector<ArchiveEntry> m_entries;
+    QHash<QString, size_t> m_lookup;
+};
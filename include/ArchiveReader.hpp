@@ -0,0 +1,75 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <ArchiveIndex.hpp>
+#include <memory>
+#include <vector>
+
+// Serves entry reads from any number of threads. Stored entries are copied
+// straight out of a shared read-only mapping; compressed ones are inflated
+// through a small pool of libzip handles, one handle per concurrent reader.
+// A file that may be rewritten while open is better not mapped: all reads
+// then go through libzip, which checks each entry's CRC, so a read racing a
+// rewrite fails instead of returning torn data or faulting on the mapping.
+// Handles opened after the index was built may see a newer central
+// directory; a stream is only opened when the entry there still matches.
+class ArchiveReader
+{
+public:
+    class Stream
+    {
+    public:
+        ~Stream();
+        zip_int64_t read(char* data, zip_uint64_t length);
+    private:
+        friend class ArchiveReader;
+        Stream(ArchiveReader* reader, struct zip* handle, struct zip_file* file);
+        ArchiveReader* m_reader;
+        struct zip* m_handle;
+        struct zip_file* m_file;
+    };
+
+    explicit ArchiveReader(const QString& path, int maxHandles = 0, bool mapFile = true);
+    ~ArchiveReader();
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+    bool open(QString* error = nullptr);
+    inline const QString& path() const { return m_path; };
+    inline const ArchiveIndex& index() const { return m_index; };
+    inline const ArchiveEntry* find(const QString& name) const { return m_index.find(name); };
+    qint64 dataOffset(const ArchiveEntry& entry) const;
+    bool read(const ArchiveEntry& entry, QByteArray* data);
+    std::unique_ptr<Stream> openStream(const ArchiveEntry& entry);
+private:
+    struct zip* acquireHandle();
+    void releaseHandle(struct zip* handle);
+    bool readStored(const ArchiveEntry& entry, QByteArray* data) const;
+private:
+    QString m_path;
+    QFile m_file;
+    const uchar* m_map = nullptr;
+    qint64 m_mapSize = 0;
+    ArchiveIndex m_index;
+    QMutex m_handlesMutex;
+    QWaitCondition m_handleReleased;
+    std::vector<struct zip*> m_handles;
+    std::vector<struct zip*> m_freeHandles;
+    int m_maxHandles;
+    bool m_mapFile;
+};
@@ -0,0 +1,65 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QtCore/QtCore>
+#include <QtGui/QtGui>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+class ImageCache
+{
+public:
+    explicit ImageCache(qint64 maxBytes = 256LL * 1024 * 1024);
+    void setMaxBytes(qint64 maxBytes);
+    qint64 maxBytes() const;
+    qint64 usedBytes() const;
+    bool find(const QString& key, QImage* image);
+    bool find(const QString& key, const QSize& size, QImage* image);
+    void insert(const QString& key, const QImage& image);
+    void insertScaled(const QString& key, const QSize& size, const QImage& image);
+    std::vector<std::pair<QString, qint64>> entries() const;
+    void remove(const QString& key);
+    void adopt(ImageCache* other, const std::function<bool(const QString&)>& keep,
+               quint64 insertedUpTo = std::numeric_limits<quint64>::max());
+    quint64 insertions() const;
+    void clear();
+private:
+    struct Entry
+    {
+        QImage Image;
+        QHash<quint64, QImage> Scaled;
+        qint64 Bytes = 0;
+        QHash<QString, qint64>* Sizes = nullptr;
+        QString Key;
+        quint64 Sequence = 0;
+        ~Entry() { if(Sizes) Sizes->remove(Key); }
+    };
+    static quint64 sizeKey(const QSize& size);
+    void insertEntry(const QString& key, Entry* entry);
+private:
+    mutable QMutex m_mutex;
+    // Mirrors the cost of every resident entry; entries drop out of it when
+    // QCache deletes them, so it can be listed without touching LRU order.
+    // Declared first so it outlives the entries.
+    QHash<QString, qint64> m_sizes;
+    QCache<QString, Entry> m_cache;
+    quint64 m_insertions = 0;
+};
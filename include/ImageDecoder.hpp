@@ -0,0 +1,88 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QtCore/QtCore>
+#include <QtGui/QtGui>
+#include <ImageCache.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Cumulative time spent per pipeline stage on the decode threads. Readers
+// take differences between two snapshots.
+struct ImageDecoderCounters
+{
+public:
+    std::atomic<qint64> ReadNs{0};
+    std::atomic<qint64> DecodeNs{0};
+    std::atomic<qint64> ScaleNs{0};
+    std::atomic<qint64> Images{0};
+};
+
+// Cancels a group of requests. The requests also add their pipeline time to
+// the token's own counters, so one slide's work can be told apart from the
+// rest of the decoder's.
+class ImageRequestToken
+{
+public:
+    ImageRequestToken() : m_state(std::make_shared<State>()) { }
+    inline void cancel() const { m_state->Cancelled.store(true); }
+    inline bool isCancelled() const { return m_state->Cancelled.load(); }
+    inline ImageDecoderCounters& counters() const { return m_state->Counters; }
+private:
+    struct State
+    {
+        std::atomic<bool> Cancelled{false};
+        ImageDecoderCounters Counters;
+    };
+    std::shared_ptr<State> m_state;
+};
+
+typedef std::function<QByteArray(const QString&)> ImageEntryReader;
+// Called once with the final image, possibly preceded by a low-resolution preview.
+typedef std::function<void(const QImage& image, const QString& error, bool preview)> ImageCallback;
+
+class ImageDecoder
+{
+public:
+    ImageDecoder(ImageEntryReader reader, ImageCache* cache);
+    ~ImageDecoder();
+    QImage image(const QString& name);
+    QImage image(const QString& name, const QSize& size);
+    void request(const QString& name, const QSize& size, const ImageRequestToken& token,
+                 QObject* context, ImageCallback callback);
+    void cancelAll();
+    void drain();
+    inline const ImageDecoderCounters& counters() const { return m_counters; };
+    static QImage decode(const QByteArray& data, const QSize& size = QSize());
+    static QImage decodePreview(const QByteArray& data, const QSize& size);
+    static QImage scale(const QImage& image, const QSize& size);
+    static const qint64 PreviewSourcePixels = 8LL * 1000 * 1000;
+private:
+    static QImage halve(const QImage& image);
+    void count(std::atomic<qint64> ImageDecoderCounters::* counter, qint64 value);
+    QByteArray read(const QString& name);
+    QImage decodeScaled(const QString& name, const QByteArray& data, const QSize& size);
+private:
+    ImageEntryReader m_reader;
+    ImageCache* m_cache;
+    QThreadPool m_pool;
+    std::atomic<quint64> m_generation;
+    ImageDecoderCounters m_counters;
+};
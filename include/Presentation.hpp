@@ -26,6 +26,12 @@
 #endif
 #include <QtGui/QtGui>
 #include <exception>
+#include <memory>
+#include <atomic>
+#include <ArchiveReader.hpp>
+#include <ImageCache.hpp>
+#include <ImageDecoder.hpp>
+#include <SlideStore.hpp>
 
 bool DoesFileExist(const char* file_name);
 
@@ -42,7 +48,7 @@ private:
 };
 
 
-enum SizeType{
+enum SizeType : uint8_t{
     none,
     pixels,
     points,
@@ -53,54 +59,133 @@ struct PresentationText
 {
 public:
     QString Text;
-    bool isBold;
-    bool isItalic;
-    bool isUnderlined;
-    bool isStrikedOut;
+    QPoint Position;
+    QSize Size;
     int Alignment;
     int fontSize;
+    uint32_t FontColor;
     SizeType fontSizeType;
-    QPoint Position;
     SizeType Position_type[2];
-    QSize Size;
     SizeType Size_type[2];
-    uint32_t FontColor;
+    bool isBold : 1;
+    bool isItalic : 1;
+    bool isUnderlined : 1;
+    bool isStrikedOut : 1;
 };
 
 struct PresentationImage
 {
 public:
     QString FileName;
+    QString Alt; 
     QPoint Position;
-    SizeType Position_type[2];
     QSize Size;
+    SizeType Position_type[2];
     SizeType Size_type[2];
-    QString Alt; 
 };
 
 struct PresentationSlide
 {
 public:
     QString SlideBackgroundFileName;
-    u_int32_t SlideBackgroundColor;
-    bool hasBackgroundColor = false;
     QString SlideTitle;
-    std::vector<PresentationText> Texts;
-    std::vector<PresentationImage> Images;
+    uint32_t SlideBackgroundColor = 0;
+    bool hasBackgroundColor = false;
+    ElementSpan<PresentationText> Texts;
+    ElementSpan<PresentationImage> Images;
+};
+
+struct PresentationSlideStore
+{
+public:
+    ElementArena<PresentationText> Texts;
+    ElementArena<PresentationImage> Images;
+    StringPool Strings;
+};
+
+enum PresentationLoadMode{
+    eager,
+    lazy,
+    streaming
+};
+
+// Shared between the thread constructing a Presentation and whoever reports
+// on it; every field may be read while loading is still in progress.
+struct PresentationLoadProgress
+{
+    std::atomic<qint64> BytesRead{0};
+    std::atomic<qint64> BytesTotal{0};
+    std::atomic<qint64> SlidesParsed{0};
+    std::atomic<qint64> SlideCount{0};
+    std::atomic<qint64> AssetsIndexed{0};
+    std::atomic<bool> Cancelled{false};
+    std::atomic<bool> Finished{false};
 };
 
 struct Presentation
 {
 public:
-    Presentation(QString FilePath);
+    struct XMLRange
+    {
+        size_t Begin;
+        size_t End;
+    };
+public:
+    Presentation(QString FilePath, PresentationLoadMode Mode = PresentationLoadMode::eager, bool UseModelCache = false,
+                 std::shared_ptr<PresentationLoadProgress> Progress = nullptr, bool MapArchive = true);
     Presentation(Presentation &);
     Presentation(Presentation &&);
     QPixmap GetImage(QString ImageFileName);
+    QPixmap GetImage(QString ImageFileName, QSize Size);
+    QImage DecodeImage(const QString& ImageFileName, const QSize& Size);
+    void RequestImage(const QString& ImageFileName, const QSize& Size, const ImageRequestToken& Token,
+                      QObject* Context, ImageCallback Callback);
+    void CancelImageRequests();
+    void DrainImageRequests();
+    void SetImageCacheBudget(qint64 Bytes);
+    ImageCache* GetImageCache();
+    const ArchiveIndex& GetArchiveIndex() const;
+    const ImageDecoderCounters& ImageCounters() const;
+    inline size_t SlideCount() const { return m_Slides.size(); };
+    PresentationSlide* GetSlide(size_t Index);
+    inline std::shared_ptr<PresentationLoadProgress> LoadProgress() const { return m_Progress; };
     ~Presentation(); 
 public:
     QString Title;
-    std::vector<PresentationSlide*> Slides;
 private:
-    struct zip *m_spres_archive;
-    QTemporaryDir m_TmpDir = QTemporaryDir();
+    void ParseMainXML();
+    void IndexMainXML();
+    void StreamMainXML();
+    void ParseSlideRange(const XMLRange& Range, PresentationSlide* Slide);
+    void CopySlides(Presentation& Other);
+    bool LoadModelCache();
+    void SaveModelCache();
+    void ReadMainXML();
+    bool MapStoredMainXML(const ArchiveEntry& Entry);
+    const ArchiveEntry& FindMainXML();
+    void InitImageDecoder();
+    void CheckCancelled();
+    void Close();
+    QByteArray ReadEntry(const QString& EntryName);
+    QByteArray ReadImageEntry(const QString& ImageFileName);
+private:
+    std::shared_ptr<ArchiveReader> m_Archive;
+    QFile m_ArchiveFile;
+    std::unique_ptr<char[]> m_XMLBuffer;
+    uchar *m_XMLMap = nullptr;
+    char *m_XMLData = nullptr;
+    qint64 m_XMLSize = 0;
+    ImageCache m_ImageCache;
+    std::unique_ptr<ImageDecoder> m_ImageDecoder;
+    PresentationSlideStore m_SlideStore;
+    std::vector<PresentationSlide> m_Slides;
+    std::vector<bool> m_SlideLoaded;
+    std::vector<XMLRange> m_SlideRanges;
+    QString m_ModelCachePath;
+    quint32 m_XMLCrc = 0;
+    QMutex m_SlidesMutex;
+    std::atomic<bool> m_StopLoading{false};
+    std::atomic<const char*> m_SlideParseError{nullptr};
+    std::unique_ptr<QThread> m_SlideLoader;
+    std::shared_ptr<PresentationLoadProgress> m_Progress = std::make_shared<PresentationLoadProgress>();
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <Presentation.hpp>
+#include <memory>
+
+// Constructs a Presentation on a worker thread. loaded() hands over ownership
+// as soon as the first slide is available; progress() keeps reporting while
+// the remaining slides are parsed and finished() follows once loading stops.
+class PresentationLoader : public QObject
+{
+    Q_OBJECT
+public:
+    PresentationLoader(const QString& filePath, PresentationLoadMode mode, bool useModelCache, QObject* parent = nullptr);
+    ~PresentationLoader();
+    void start();
+    void cancel();
+    inline const QString& filePath() const { return m_filePath; };
+    inline void setMapArchive(bool map) { m_mapArchive = map; };
+signals:
+    void progress(qint64 bytesRead, qint64 bytesTotal, qint64 slidesParsed, qint64 slideCount, qint64 assetsIndexed);
+    void loaded(Presentation* presentation);
+    void failed(const QString& error);
+    void cancelled();
+    void finished();
+private:
+    void finishLoading();
+    void reportProgress();
+private:
+    QString m_filePath;
+    PresentationLoadMode m_mode;
+    bool m_useModelCache;
+    bool m_mapArchive = true;
+    std::shared_ptr<PresentationLoadProgress> m_progress;
+    std::unique_ptr<QThread> m_thread;
+    Presentation* m_presentation = nullptr;
+    QString m_error;
+    QTimer* m_progressTimer;
+    bool m_delivered = false;
+};
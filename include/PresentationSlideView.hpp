@@ -18,7 +18,10 @@
 #pragma once
 #include <QtWidgets/QtWidgets>
 #include <Presentation.hpp>
-#include <vector>
+#include <SlideRenderer.hpp>
+#include <SlideTransition.hpp>
+#include <SlideTimingLog.hpp>
+#include <memory>
 
 class PresentationSlideView : public QWidget
 {
@@ -26,13 +29,46 @@ class PresentationSlideView : public QWidget
 public:
     explicit PresentationSlideView(QWidget *parent = nullptr);
     void setSlide(Presentation* presentation, unsigned int index);
+    void setFrame(Presentation* presentation, unsigned int index, const QImage& frame, bool animate = false,
+                  bool reverse = false);
+    void adoptSlide(Presentation* presentation, unsigned int index, std::unique_ptr<SlideRenderer> renderer,
+                    const ImageRequestToken& token);
+    void adoptedItemReady(size_t item);
+    void reloadSlide(Presentation* presentation, unsigned int index, const QRegion& dirty);
+    void setTransition(SlideTransitionType type, int duration);
+    inline bool isTransitionRunning() const { return m_transition.isRunning(); };
+    inline const SlideTransitionStats& transitionStats() const { return m_transition.stats(); };
+    inline void setTimingLog(SlideTimingLog* timings) { m_timings = timings; };
     void clearSlideView();
+    inline unsigned int slideIndex() const { return m_index; };
+    inline QSize frameSize() const { return this->size() * this->devicePixelRatioF(); };
+    static QRect slideGeometry(const QSize& parentSize);
     ~PresentationSlideView();
+signals:
+    void frameRendered(unsigned int index, const QImage& frame);
+    void slidePresented(unsigned int index);
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+private:
+    inline const SlideRenderer& activeRenderer() const { return m_adopted ? *m_adopted : m_renderer; };
+    void buildDisplayList();
+    void handleItemReady(size_t item);
+    void finishFrame();
+    void finishReload();
+    void advanceTransition();
+    void stopTransition();
 private:
     Presentation *m_presentation = nullptr;
     PresentationSlide *m_slide = nullptr;
-    QWidget *m_parentWidget = nullptr;
-    std::vector<QWidget*> m_imagesWidgets;
-    std::vector<QWidget*> m_textWidgets;
-    QLabel *m_backgroundImage = nullptr;
+    unsigned int m_index = 0;
+    QImage m_frame;
+    SlideRenderer m_renderer;
+    std::unique_ptr<SlideRenderer> m_adopted;
+    ImageRequestToken m_imageRequests;
+    SlideTransition m_transition;
+    QTimer *m_transitionTimer;
+    SlideTimingLog *m_timings = nullptr;
+    QRegion m_reloadRegion;
+    bool m_reloadPending = false;
 };
\ No newline at end of file
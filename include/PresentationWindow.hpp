@@ -20,24 +20,82 @@
 #include <QtWidgets/QtWidgets>
 #include <Presentation.hpp>
 #include <PresentationSlideView.hpp>
+#include <PresentationLoader.hpp>
+#include <ResidencyManager.hpp>
+#include <SlideFrameCache.hpp>
+#include <SlideRenderer.hpp>
+#include <map>
+#include <memory>
 
 class PresentationWindow : public QMainWindow
 {
     Q_OBJECT
 public:
     explicit PresentationWindow(QWidget *parent = nullptr);
+    ~PresentationWindow();
     void RetranslateUI();
     void setPresentation(Presentation* presentation);
     inline bool hasPresentation() const { return !(!m_presentation); };
+    void setPrefetchWindow(unsigned int window);
+    inline unsigned int prefetchWindow() const { return m_prefetchWindow; };
+    void setFrameCacheBudget(qint64 bytes);
+    void setMemoryCeiling(qint64 bytes);
+    void setLiveReload(const QString& filePath);
+    inline const QString& liveReloadPath() const { return m_reloadPath; };
+    void reloadPresentation(Presentation* updated);
+    inline const ResidencyManager& residency() const { return m_residency; };
+    void setTransition(SlideTransitionType type, int duration = 250);
+    inline SlideTransitionType transitionType() const { return m_transitionType; };
+    inline const SlideTimingLog& timings() const { return m_timings; };
+    bool exportTimings(const QString& path) const;
+    void setTimingOverlayVisible(bool visible);
+signals:
+    void slideShown(unsigned int index);
+protected:
+    void resizeEvent(QResizeEvent *event) override;
 private:
+    struct PendingFrame
+    {
+        std::unique_ptr<SlideRenderer> Renderer = std::make_unique<SlideRenderer>();
+        ImageRequestToken Token;
+        ~PendingFrame() { if(Renderer) Token.cancel(); }
+    };
     void handleNextSlideAction();
     void handlePreviousSlideSlideAction();
     void handleCloseWindowAction();
+    void handleToggleTimingsAction();
+    void handleWatchedFileChanged();
+    void startReload();
+    void updateTimingOverlay();
+    void handleFrameRendered(unsigned int index, const QImage& frame);
+    void showSlide(unsigned int index);
+    void prefetchSlides();
+    void prefetchFrame(unsigned int index);
+    void handlePendingItem(unsigned int index, size_t item);
+    void completePendingFrame(unsigned int index);
+    void clearPrefetchedSlides();
+    void releasePresentation();
 private:
     QWidget* m_Window;
-    Presentation *m_presentation;
-    PresentationSlideView *m_slideView;
-    unsigned int m_currentSlide;
-    QAction *m_nextSlideAction, *m_previousSlideAction, *m_closeWindowAction;
-    QLabel *m_currentSlideLabel;
+    Presentation *m_presentation = nullptr;
+    PresentationSlideView *m_slideView = nullptr;
+    unsigned int m_currentSlide = 0;
+    QAction *m_nextSlideAction, *m_previousSlideAction, *m_closeWindowAction, *m_toggleTimingsAction;
+    QLabel *m_currentSlideLabel = nullptr;
+    QLabel *m_timingLabel = nullptr;
+    SlideTimingLog m_timings;
+    QString m_timingExportPath;
+    std::map<unsigned int, std::unique_ptr<PendingFrame>> m_pendingFrames;
+    SlideFrameCache m_frameCache;
+    ResidencyManager m_residency;
+    QString m_reloadPath;
+    QFileSystemWatcher *m_reloadWatcher = nullptr;
+    QTimer *m_reloadTimer = nullptr;
+    QPointer<PresentationLoader> m_reloadLoader;
+    bool m_reloadMarked = false;
+    quint64 m_reloadCacheMark = 0;
+    unsigned int m_prefetchWindow = 1;
+    QTimer *m_prefetchTimer;
+    SlideTransitionType m_transitionType = cut;
+    int m_transitionDuration = 250;
 };
\ No newline at end of file
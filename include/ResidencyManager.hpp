@@ -0,0 +1,69 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <ImageCache.hpp>
+#include <Presentation.hpp>
+#include <SlideFrameCache.hpp>
+#include <vector>
+
+// Keeps decoded images and rendered frames within their budgets. Before
+// either cache is full, trim() drops whatever is used farthest from the
+// current slide, so QCache's own LRU eviction is only a backstop. When a
+// ceiling is set, the two budgets are split from it and replace whatever the
+// caches were configured with; otherwise their own budgets are left alone.
+class ResidencyManager
+{
+public:
+    explicit ResidencyManager(qint64 ceiling = 0);
+    void setCeiling(qint64 bytes);
+    inline bool hasCeiling() const { return m_ceiling > 0; };
+    qint64 ceiling() const;
+    void attach(ImageCache* images, SlideFrameCache* frames);
+    void detach();
+    void noteSlide(unsigned int index, const PresentationSlide* slide);
+    void setCurrentSlide(unsigned int index);
+    void trim();
+    qint64 usedBytes() const;
+    inline qint64 peakBytes() const { return m_peak; };
+    inline qint64 evictedBytes() const { return m_evicted; };
+    qint64 slideBytes(unsigned int index) const;
+    QString summary() const;
+private:
+    struct Candidate
+    {
+        unsigned int Distance;
+        bool Frame;
+        unsigned int Index;
+        QString Name;
+        qint64 Bytes;
+    };
+    unsigned int distance(unsigned int index) const;
+    unsigned int imageDistance(const QString& name) const;
+    void applyCaps();
+    void updatePeak();
+private:
+    qint64 m_ceiling;
+    qint64 m_peak = 0;
+    qint64 m_evicted = 0;
+    unsigned int m_current = 0;
+    ImageCache* m_images = nullptr;
+    SlideFrameCache* m_frames = nullptr;
+    QHash<QString, std::vector<unsigned int>> m_imageSlides;
+    QHash<unsigned int, std::vector<QString>> m_slideImages;
+};
@@ -0,0 +1,50 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <QtGui/QtGui>
+#include <Presentation.hpp>
+#include <functional>
+#include <vector>
+
+typedef std::function<bool(const QString& fileName)> AssetChangedFunction;
+
+// Per-element differences between two versions of a slide. Elements are
+// matched by position in the slide; if the element counts differ the whole
+// slide is considered changed.
+class SlideDiff
+{
+public:
+    SlideDiff() = default;
+    static SlideDiff compare(const PresentationSlide* before, const PresentationSlide* after,
+                             const AssetChangedFunction& assetChanged);
+    inline bool isEmpty() const { return !m_background && !m_layout && m_images.empty() && m_texts.empty(); };
+    inline bool backgroundChanged() const { return m_background; };
+    inline bool layoutChanged() const { return m_layout; };
+    inline const std::vector<size_t>& images() const { return m_images; };
+    inline const std::vector<size_t>& texts() const { return m_texts; };
+    QRegion dirtyRegion(const PresentationSlide* before, const PresentationSlide* after, const QSize& size) const;
+private:
+    static bool sameText(const PresentationText& a, const PresentationText& b);
+    static bool sameImage(const PresentationImage& a, const PresentationImage& b);
+private:
+    bool m_background = false;
+    bool m_layout = false;
+    std::vector<size_t> m_images;
+    std::vector<size_t> m_texts;
+};
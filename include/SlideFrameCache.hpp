@@ -0,0 +1,42 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QtCore/QtCore>
+#include <QtGui/QtGui>
+
+class SlideFrameCache
+{
+public:
+    explicit SlideFrameCache(qint64 maxBytes = 512LL * 1024 * 1024);
+    void setMaxBytes(qint64 maxBytes);
+    inline qint64 maxBytes() const { return m_frames.maxCost(); };
+    inline qint64 usedBytes() const { return m_frames.totalCost(); };
+    void setFrameSize(const QSize& size);
+    inline QSize frameSize() const { return m_frameSize; };
+    bool find(unsigned int index, QImage* frame);
+    inline bool contains(unsigned int index) const { return m_frames.contains(index); };
+    inline QList<unsigned int> indices() const { return m_frames.keys(); };
+    inline qint64 frameBytes() const { return (qint64)m_frameSize.width() * m_frameSize.height() * 4; };
+    void insert(unsigned int index, const QImage& frame);
+    void remove(unsigned int index);
+    void clear();
+private:
+    QSize m_frameSize;
+    QCache<unsigned int, QImage> m_frames;
+};
@@ -0,0 +1,46 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <Presentation.hpp>
+#include <vector>
+
+// Binary image of a parsed slide model, keyed by the CRC and size of main.xml.
+// The file is mapped and copied straight into the slide store, no XML involved.
+class SlideModelCache
+{
+public:
+    SlideModelCache() = default;
+    ~SlideModelCache();
+    SlideModelCache(const SlideModelCache&) = delete;
+    SlideModelCache& operator=(const SlideModelCache&) = delete;
+    static const qint64 MaxDirectoryBytes = 64LL * 1024 * 1024;
+    static QString cachePath(quint32 xmlCrc, quint64 xmlSize);
+    static void prune(const QString& keepPath, qint64 maxBytes = MaxDirectoryBytes);
+    static bool save(const QString& path, quint32 xmlCrc, quint64 xmlSize, const QString& title,
+                     const std::vector<PresentationSlide>& slides);
+    bool open(const QString& path, quint32 xmlCrc, quint64 xmlSize);
+    void load(PresentationSlideStore* store, std::vector<PresentationSlide>* slides, QString* title) const;
+    void close();
+private:
+    bool validate() const;
+private:
+    QFile m_file;
+    const uchar* m_data = nullptr;
+    qint64 m_size = 0;
+};
@@ -0,0 +1,74 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QtCore/QtCore>
+#include <QtGui/QtGui>
+#include <Presentation.hpp>
+#include <vector>
+#include <functional>
+
+struct SlideDisplayItem
+{
+public:
+    enum ItemType{
+        BackgroundImage,
+        Image,
+        Text
+    };
+    ItemType Type;
+    QRect Rect;
+    QString FileName;
+    QString Text;
+    QFont Font;
+    QColor Color;
+    int Alignment = Qt::AlignCenter;
+    QImage Image;
+    bool Preview = false;
+    bool Failed = false;
+};
+
+typedef std::function<void(size_t item)> SlideItemCallback;
+
+class SlideRenderer
+{
+public:
+    SlideRenderer() = default;
+    void setSlide(const PresentationSlide* slide, const QSize& size, qreal devicePixelRatio = 1.0);
+    void clear();
+    inline const PresentationSlide* slide() const { return m_slide; };
+    inline QSize size() const { return m_size; };
+    inline qreal devicePixelRatio() const { return m_devicePixelRatio; };
+    inline const std::vector<SlideDisplayItem>& items() const { return m_items; };
+    QSize imageSize(size_t item) const;
+    void setImage(size_t item, const QImage& image, bool preview = false);
+    void setImageFailed(size_t item);
+    bool isComplete() const;
+    void loadImages(Presentation* presentation);
+    void requestImages(Presentation* presentation, const ImageRequestToken& token,
+                       QObject* context, SlideItemCallback itemReady);
+    void paint(QPainter& painter, const QRect& exposed = QRect()) const;
+    QImage render() const;
+    inline QSize frameSize() const { return m_size * m_devicePixelRatio; };
+private:
+    const PresentationSlide* m_slide = nullptr;
+    QSize m_size;
+    qreal m_devicePixelRatio = 1.0;
+    QColor m_backgroundColor = QColor::fromRgb(255, 255, 255, 255);
+    std::vector<SlideDisplayItem> m_items;
+};
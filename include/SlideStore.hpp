@@ -0,0 +1,119 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QtCore/QtCore>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+template<typename T>
+class ElementSpan
+{
+public:
+    ElementSpan() = default;
+    ElementSpan(T* data, size_t size) : m_data(data), m_size((quint32)size) { }
+    inline T* begin() const { return m_data; };
+    inline T* end() const { return m_data + m_size; };
+    inline size_t size() const { return m_size; };
+    inline bool empty() const { return !m_size; };
+    inline T& operator[](size_t index) const { return m_data[index]; };
+    T& at(size_t index) const
+    {
+        if(index >= m_size)
+            throw std::out_of_range("ElementSpan::at");
+        return m_data[index];
+    }
+private:
+    T* m_data = nullptr;
+    quint32 m_size = 0;
+};
+
+// Hands out contiguous runs of elements from large chunks that never move,
+// so spans stay valid while other slides keep being appended.
+template<typename T>
+class ElementArena
+{
+public:
+    explicit ElementArena(size_t chunkSize = 256) : m_chunkSize(chunkSize) { }
+    ElementArena(const ElementArena&) = delete;
+    ElementArena& operator=(const ElementArena&) = delete;
+    ElementSpan<T> allocate(std::vector<T>& elements)
+    {
+        if(elements.empty())
+            return ElementSpan<T>();
+        QMutexLocker locker(&m_mutex);
+        if(m_chunks.empty() || m_used + elements.size() > m_capacity){
+            m_capacity = std::max(m_chunkSize, elements.size());
+            m_chunks.emplace_back(new T[m_capacity]);
+            m_reserved += m_capacity;
+            m_used = 0;
+        }
+        T* data = m_chunks.back().get() + m_used;
+        std::move(elements.begin(), elements.end(), data);
+        m_used += elements.size();
+        return ElementSpan<T>(data, elements.size());
+    }
+    // Takes over the chunks of another arena. Spans into them stay valid.
+    void adopt(ElementArena& other)
+    {
+        QMutexLocker locker(&m_mutex);
+        QMutexLocker otherLocker(&other.m_mutex);
+        if(other.m_chunks.empty())
+            return;
+        if(m_chunks.empty()){
+            m_capacity = other.m_capacity;
+            m_used = other.m_used;
+            m_chunks = std::move(other.m_chunks);
+        }
+        else{
+            m_chunks.insert(m_chunks.end() - 1, std::make_move_iterator(other.m_chunks.begin()),
+                            std::make_move_iterator(other.m_chunks.end()));
+        }
+        m_reserved += other.m_reserved;
+        other.m_chunks.clear();
+        other.m_capacity = other.m_used = other.m_reserved = 0;
+    }
+    size_t reservedBytes() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_reserved * sizeof(T);
+    }
+private:
+    mutable QMutex m_mutex;
+    size_t m_chunkSize;
+    size_t m_capacity = 0;
+    size_t m_used = 0;
+    size_t m_reserved = 0;
+    std::vector<std::unique_ptr<T[]>> m_chunks;
+};
+
+class StringPool
+{
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    QString intern(const QString& string);
+    size_t size() const;
+private:
+    mutable QMutex m_mutex;
+    QSet<QString> m_strings;
+};
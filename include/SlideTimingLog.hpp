@@ -0,0 +1,80 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <ImageDecoder.hpp>
+#include <deque>
+
+struct SlideSwitchTiming
+{
+public:
+    unsigned int Slide = 0;
+    bool Cached = false;
+    qint64 StartedMs = 0;
+    double ReadMs = 0.0;
+    double DecodeMs = 0.0;
+    double ScaleMs = 0.0;
+    double LayoutMs = 0.0;
+    double RenderMs = 0.0;
+    double FirstPaintMs = -1.0;
+    double TotalMs = 0.0;
+    qint64 Images = 0;
+    int TransitionFrames = 0;
+    double TransitionMaxFrameMs = 0.0;
+};
+
+// Times each slide switch from the input that caused it until the complete
+// slide is on screen. Read, decode and scale only count the image requests
+// made for the slide being shown, not prefetching of its neighbours.
+class SlideTimingLog
+{
+public:
+    explicit SlideTimingLog(size_t capacity = 1000);
+    void begin(unsigned int slide);
+    void trackRequests(const ImageRequestToken& token);
+    void cancel();
+    inline bool isActive() const { return m_active; };
+    void setCached(bool cached);
+    void addLayout(double ms);
+    void addRender(double ms);
+    void setTransition(int frames, double maxFrameMs);
+    bool markPainted(bool complete);
+    inline const std::deque<SlideSwitchTiming>& records() const { return m_records; };
+    inline const SlideSwitchTiming* last() const { return m_records.empty() ? nullptr : &m_records.back(); };
+    void clear();
+    QString summary() const;
+    bool exportJson(const QString& path) const;
+    bool exportCsv(const QString& path) const;
+    bool exportFile(const QString& path) const;
+private:
+    double elapsedMs() const;
+    void collectRequests();
+private:
+    size_t m_capacity;
+    std::deque<SlideSwitchTiming> m_records;
+    SlideSwitchTiming m_current;
+    bool m_active = false;
+    ImageRequestToken m_requests;
+    bool m_tracking = false;
+    qint64 m_readNs = 0;
+    qint64 m_decodeNs = 0;
+    qint64 m_scaleNs = 0;
+    qint64 m_images = 0;
+    QElapsedTimer m_switchTimer;
+    QElapsedTimer m_logTimer;
+};
@@ -0,0 +1,79 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <QtGui/QtGui>
+
+enum SlideTransitionType{
+    cut,
+    crossfade,
+    push,
+    wipe
+};
+
+struct SlideTransitionStats
+{
+public:
+    int Frames = 0;
+    int Interval = 0;
+    double LastFrameMs = 0.0;
+    double MaxFrameMs = 0.0;
+    double TotalFrameMs = 0.0;
+};
+
+// Composites two pre-rendered slide frames on the CPU. Progress follows the
+// wall clock, so when a frame takes longer than its tick the tick is widened
+// and the transition shows fewer frames but still ends on time.
+class SlideTransition
+{
+public:
+    static const int TargetInterval = 16;
+    static const int MaxInterval = 66;
+    SlideTransition() = default;
+    inline void setType(SlideTransitionType type) { m_type = type; };
+    inline SlideTransitionType type() const { return m_type; };
+    inline void setDuration(int duration) { m_duration = qMax(0, duration); };
+    inline int duration() const { return m_duration; };
+    bool start(const QImage& from, const QImage& to, bool reverse = false);
+    bool advance();
+    void stop();
+    void reset();
+    inline bool isRunning() const { return m_running; };
+    inline const QImage& frame() const { return m_frame; };
+    inline int interval() const { return m_interval; };
+    inline const SlideTransitionStats& stats() const { return m_stats; };
+    static bool canComposite(const QImage& from, const QImage& to);
+    static void composite(SlideTransitionType type, const QImage& from, const QImage& to,
+                          qreal progress, bool reverse, QImage* out);
+    static SlideTransitionType typeFromString(const QString& name, SlideTransitionType fallback = cut);
+private:
+    static void crossfadeFrames(const QImage& from, const QImage& to, int alpha, QImage* out);
+    static void pushFrames(const QImage& from, const QImage& to, int offset, bool reverse, QImage* out);
+    static void wipeFrames(const QImage& from, const QImage& to, int edge, bool reverse, QImage* out);
+private:
+    SlideTransitionType m_type = cut;
+    int m_duration = 250;
+    bool m_reverse = false;
+    bool m_running = false;
+    QImage m_from;
+    QImage m_to;
+    QImage m_frame;
+    QElapsedTimer m_clock;
+    int m_interval = TargetInterval;
+    SlideTransitionStats m_stats;
+};
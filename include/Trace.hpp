@@ -0,0 +1,62 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <QtCore/QtCore>
+#include <atomic>
+
+// Scoped timing events written as a Chrome JSON trace (chrome://tracing,
+// Perfetto). Enabled with --trace <file> or SIMPLEPRESS_TRACE=<file>; when
+// disabled a scope costs one relaxed atomic load.
+class Trace
+{
+public:
+    static bool configure(int argc, char** argv);
+    static bool start(const QString& path);
+    static bool stop();
+    static inline bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); };
+    static qint64 now();
+    static void record(const char* name, const char* category, qint64 begin, qint64 duration);
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+class TraceScope
+{
+public:
+    inline TraceScope(const char* name, const char* category = "app") {
+        if(Trace::isEnabled()){
+            m_name = name;
+            m_category = category;
+            m_begin = Trace::now();
+        }
+    }
+    inline ~TraceScope() {
+        if(m_name)
+            Trace::record(m_name, m_category, m_begin, Trace::now() - m_begin);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+private:
+    const char* m_name = nullptr;
+    const char* m_category = nullptr;
+    qint64 m_begin = 0;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
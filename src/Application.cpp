@@ -19,24 +19,22 @@
 #include <MainWindow.hpp>
 #include <PresentationWindow.hpp>
 #include <Presentation.hpp>
+#include <limits>
+
+static bool IsLiveReloadEnabled(){
+    QString liveReload = qEnvironmentVariable("SIMPLEPRESS_LIVE_RELOAD");
+    return !liveReload.isEmpty() && liveReload != "0";
+}
+
+static bool IsModelCacheEnabled(){
+    return qEnvironmentVariable("SIMPLEPRESS_MODEL_CACHE") != "0";
+}
 
 Application::Application(int &argc, char **argv) : QApplication(argc, argv)
 {
     for(int i = 0; i < argc; i++){
         if(DoesFileExist(argv[i]) && QString(argv[i]).endsWith(".spres")){  
-            Presentation* pres = nullptr;
-            try{
-                pres = new Presentation(argv[i]);
-            }
-            catch (PresentationException& e){
-                QMessageBox *messageBox = new QMessageBox();
-                messageBox->setWindowTitle("Failed to Load Presentation");
-                messageBox->setText(QString("Failed to Load Presentation:\n   " + QString(e.what())));
-                messageBox->show();
-                continue;
-            }
-            presentationWindow = new PresentationWindow();
-            presentationWindow->setPresentation(pres);
+            OpenPresentation(argv[i]);
         }
     }
 }
@@ -44,33 +42,87 @@ Application::Application(int &argc, char **argv) : QApplication(argc, argv)
 bool Application::event(QEvent *event){
     if (event->type() == QEvent::FileOpen) {
         QFileOpenEvent *openEvent = static_cast<QFileOpenEvent *>(event);
-        Presentation* pres = nullptr;
-            try{
-                pres = new Presentation(openEvent->file());
-            }
-            catch (PresentationException& e){
-                QMessageBox *messageBox = new QMessageBox();
-                messageBox->setWindowTitle("Failed to Load Presentation");
-                messageBox->setText(QString("Failed to Load Presentation:\n   " + QString(e.what())));
-                messageBox->show();
-                return QApplication::event(event);
-            }
-            if(mainWindow)
-                mainWindow->hide();
-            if(presentationWindow){
-                presentationWindow->setPresentation(pres);
-                presentationWindow->showFullScreen();
-
-            }
-            else{
-                presentationWindow = new PresentationWindow();
-                presentationWindow->setPresentation(pres);
-                presentationWindow->showFullScreen();
-            }
+        OpenPresentation(openEvent->file());
     }
     return QApplication::event(event);
 }
 
+void Application::OpenPresentation(const QString& FilePath){
+    if(m_presentationLoader){
+        m_presentationLoader->cancel();
+        m_presentationLoader->deleteLater();
+    }
+    PresentationLoader* loader = new PresentationLoader(FilePath, PresentationLoadMode::lazy, IsModelCacheEnabled(), this);
+    // A watched deck may be rewritten in place while it is open.
+    loader->setMapArchive(!IsLiveReloadEnabled());
+    m_presentationLoader = loader;
+
+    // Files passed on the command line are opened before any window exists;
+    // the dialog needs a visible owner to be modal to.
+    QWidget* owner = presentationWindow && presentationWindow->isVisible() ? (QWidget*)presentationWindow : nullptr;
+    if(!owner){
+        if(!mainWindow)
+            mainWindow = new MainWindow();
+        mainWindow->show();
+        owner = mainWindow;
+    }
+    QProgressDialog* progressDialog = new QProgressDialog("Loading " + QFileInfo(FilePath).fileName() + "...", "Cancel", 0, 0, owner);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setWindowTitle("Simple Press 2");
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+    connect(progressDialog, &QProgressDialog::canceled, loader, &PresentationLoader::cancel);
+    connect(loader, &QObject::destroyed, progressDialog, &QObject::deleteLater);
+    connect(loader, &PresentationLoader::progress, progressDialog,
+            [progressDialog, FilePath](qint64 bytesRead, qint64 bytesTotal, qint64 slidesParsed, qint64 slideCount, qint64){
+        if(slideCount > 0){
+            progressDialog->setMaximum((int)qMin<qint64>(slideCount, std::numeric_limits<int>::max()));
+            progressDialog->setValue((int)qMin<qint64>(slidesParsed, progressDialog->maximum()));
+            progressDialog->setLabelText(QString("Parsing %1: slide %2 of %3").arg(QFileInfo(FilePath).fileName()).arg(slidesParsed).arg(slideCount));
+        }
+        else if(bytesTotal > 0){
+            progressDialog->setMaximum(100);
+            progressDialog->setValue((int)(bytesRead * 100 / bytesTotal));
+            progressDialog->setLabelText(QString("Reading %1: %2 of %3 KiB").arg(QFileInfo(FilePath).fileName()).arg(bytesRead / 1024).arg(bytesTotal / 1024));
+        }
+    });
+    connect(loader, &PresentationLoader::loaded, this, [this, progressDialog, FilePath](Presentation* pres){
+        progressDialog->deleteLater();
+        ShowPresentation(pres, FilePath);
+    });
+    connect(loader, &PresentationLoader::failed, this, [this, progressDialog](const QString& error){
+        progressDialog->deleteLater();
+        ShowLoadError(error);
+    });
+    connect(loader, &PresentationLoader::cancelled, this, [this, progressDialog](){
+        progressDialog->deleteLater();
+        if(!presentationWindow && mainWindow)
+            mainWindow->show();
+    });
+    connect(loader, &PresentationLoader::finished, loader, &QObject::deleteLater);
+    loader->start();
+}
+
+void Application::ShowPresentation(Presentation* Pres, const QString& FilePath){
+    if(mainWindow)
+        mainWindow->hide();
+    if(!presentationWindow)
+        presentationWindow = new PresentationWindow();
+    presentationWindow->setPresentation(Pres);
+    presentationWindow->setLiveReload(IsLiveReloadEnabled() ? FilePath : QString());
+    presentationWindow->showFullScreen();
+}
+
+void Application::ShowLoadError(const QString& Error){
+    QMessageBox *messageBox = new QMessageBox();
+    messageBox->setWindowTitle("Failed to Load Presentation");
+    messageBox->setText(QString("Failed to Load Presentation:\n   " + Error));
+    messageBox->show();
+    if(!presentationWindow && mainWindow)
+        mainWindow->show();
+}
+
 int Application::Execute(){
     if(!mainWindow)
         mainWindow = new MainWindow();
@@ -80,6 +132,8 @@ int Application::Execute(){
             return exec();
         }
     }
+    if(m_presentationLoader)
+        return exec();
     mainWindow->show();
     return exec();
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <ArchiveIndex.hpp>
+
+#define ZIP_EOCD_LENGTH 22
+#define ZIP_CD_HEADER_LENGTH 46
+#define ZIP_LOCAL_HEADER_LENGTH 30
+
+// libzip's ZIP_FL_NOCASE lookup only ignores the case of ASCII letters, so
+// names differing in any other character must stay distinct here too.
+QString ArchiveIndex::key(const QString& name){
+    QString folded = name;
+    for(QChar& c : folded){
+        if(c.unicode() >= 'A' && c.unicode() <= 'Z')
+            c = QChar(c.unicode() + ('a' - 'A'));
+    }
+    return folded;
+}
+
+bool ArchiveIndex::build(struct zip* archive, const uchar* data, qint64 dataSize){
+    m_entries.clear();
+    m_lookup.clear();
+    zip_int64_t count = zip_get_num_entries(archive, 0);
+    if(count < 0)
+        return false;
+    m_entries.resize((size_t)count);
+    m_lookup.reserve((qsizetype)count);
+    for(zip_int64_t i = 0; i < count; i++){
+        ArchiveEntry& entry = m_entries[(size_t)i];
+        entry.Index = (zip_uint64_t)i;
+        struct zip_stat zs;
+        zip_stat_init(&zs);
+        if(zip_stat_index(archive, (zip_uint64_t)i, 0, &zs) || !(zs.valid & ZIP_STAT_NAME))
+            continue;
+        entry.Name = QString::fromUtf8(zs.name);
+        entry.Valid = zs.valid;
+        entry.Size = (zs.valid & ZIP_STAT_SIZE) ? zs.size : 0;
+        entry.CompressedSize = (zs.valid & ZIP_STAT_COMP_SIZE) ? zs.comp_size : 0;
+        entry.Crc = (zs.valid & ZIP_STAT_CRC) ? zs.crc : 0;
+        entry.CompressionMethod = (zs.valid & ZIP_STAT_COMP_METHOD) ? zs.comp_method : 0;
+        entry.EncryptionMethod = (zs.valid & ZIP_STAT_ENCRYPTION_METHOD) ? zs.encryption_method : ZIP_EM_NONE;
+        QString entryKey = key(entry.Name);
+        if(!m_lookup.contains(entryKey))
+            m_lookup.insert(entryKey, (size_t)i);
+    }
+    if(data)
+        readLocalHeaderOffsets(data, dataSize);
+    return true;
+}
+
+const ArchiveEntry* ArchiveIndex::find(const QString& name) const{
+    auto it = m_lookup.constFind(key(name));
+    if(it == m_lookup.constEnd())
+        return nullptr;
+    return &m_entries[it.value()];
+}
+
+// True when both archives hold the same bytes for the entry, judged by CRC
+// and sizes; entries without a CRC are treated as changed.
+bool ArchiveIndex::sameEntry(const ArchiveIndex& other, const QString& name) const{
+    const ArchiveEntry* entry = find(name);
+    const ArchiveEntry* otherEntry = other.find(name);
+    if(!entry || !otherEntry || !(entry->Valid & ZIP_STAT_CRC) || !(otherEntry->Valid & ZIP_STAT_CRC))
+        return false;
+    return entry->Crc == otherEntry->Crc && entry->Size == otherEntry->Size &&
+           entry->CompressedSize == otherEntry->CompressedSize;
+}
+
+// libzip numbers entries in central directory order, so the n-th record
+// belongs to entry n as long as the names agree.
+void ArchiveIndex::readLocalHeaderOffsets(const uchar* data, qint64 dataSize){
+    if(dataSize < ZIP_EOCD_LENGTH)
+        return;
+    qint64 eocd = dataSize - ZIP_EOCD_LENGTH;
+    qint64 eocdMin = qMax<qint64>(0, eocd - 0xFFFF);
+    while(eocd >= eocdMin && qFromLittleEndian<quint32>(data + eocd) != 0x06054b50)
+        eocd--;
+    if(eocd < eocdMin)
+        return;
+    quint16 records = qFromLittleEndian<quint16>(data + eocd + 10);
+    quint32 cdSize = qFromLittleEndian<quint32>(data + eocd + 12);
+    quint32 cdOffset = qFromLittleEndian<quint32>(data + eocd + 16);
+    if(cdOffset == 0xFFFFFFFF || (qint64)cdOffset + cdSize > eocd)
+        return;
+    qint64 pos = cdOffset, cdEnd = (qint64)cdOffset + cdSize;
+    for(size_t i = 0; i < records && i < m_entries.size(); i++){
+        if(pos + ZIP_CD_HEADER_LENGTH > cdEnd || qFromLittleEndian<quint32>(data + pos) != 0x02014b50)
+            return;
+        const uchar* cd = data + pos;
+        quint16 n = qFromLittleEndian<quint16>(cd + 28);
+        quint16 e = qFromLittleEndian<quint16>(cd + 30);
+        quint16 c = qFromLittleEndian<quint16>(cd + 32);
+        quint32 local = qFromLittleEndian<quint32>(cd + 42);
+        if(pos + ZIP_CD_HEADER_LENGTH + n > cdEnd)
+            return;
+        QByteArray name = m_entries[i].Name.toUtf8();
+        if(local != 0xFFFFFFFF && name.size() == n && !memcmp(cd + ZIP_CD_HEADER_LENGTH, name.constData(), n))
+            m_entries[i].LocalHeaderOffset = local;
+        pos += ZIP_CD_HEADER_LENGTH + n + e + c;
+    }
+}
+
+qint64 ArchiveIndex::dataOffset(const uchar* data, qint64 dataSize, const ArchiveEntry& entry){
+    qint64 local = entry.LocalHeaderOffset;
+    if(local < 0 || local + ZIP_LOCAL_HEADER_LENGTH > dataSize || qFromLittleEndian<quint32>(data + local) != 0x04034b50)
+        return -1;
+    qint64 offset = local + ZIP_LOCAL_HEADER_LENGTH +
+                    qFromLittleEndian<quint16>(data + local + 26) +
+                    qFromLittleEndian<quint16>(data + local + 28);
+    if(offset + (qint64)entry.CompressedSize > dataSize)
+        return -1;
+    return offset;
+}
@@ -0,0 +1,163 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <ArchiveReader.hpp>
+#include <limits>
+
+#define BUF_LENGTH 64
+
+ArchiveReader::Stream::Stream(ArchiveReader* reader, struct zip* handle, struct zip_file* file)
+    : m_reader(reader), m_handle(handle), m_file(file) { }
+
+ArchiveReader::Stream::~Stream(){
+    zip_fclose(m_file);
+    m_reader->releaseHandle(m_handle);
+}
+
+zip_int64_t ArchiveReader::Stream::read(char* data, zip_uint64_t length){
+    return zip_fread(m_file, data, length);
+}
+
+ArchiveReader::ArchiveReader(const QString& path, int maxHandles, bool mapFile)
+    : m_path(path), m_file(path), m_maxHandles(maxHandles > 0 ? maxHandles : qMax(2, QThread::idealThreadCount())),
+      m_mapFile(mapFile) { }
+
+ArchiveReader::~ArchiveReader(){
+    for(struct zip* handle : m_handles)
+        zip_close(handle);
+    if(m_map)
+        m_file.unmap((uchar*)m_map);
+}
+
+bool ArchiveReader::open(QString* error){
+    int z_err;
+    struct zip* handle = zip_open(m_path.toStdString().c_str(), ZIP_RDONLY, &z_err);
+    if(!handle){
+        if(error){
+            char buf[BUF_LENGTH];
+            zip_error_to_str(buf, BUF_LENGTH, z_err, errno);
+            *error = QString(buf);
+        }
+        return false;
+    }
+    m_handles.push_back(handle);
+    m_freeHandles.push_back(handle);
+    if(m_mapFile && m_file.open(QIODevice::ReadOnly)){
+        m_mapSize = m_file.size();
+        m_map = m_file.map(0, m_mapSize);
+        if(!m_map)
+            m_mapSize = 0;
+    }
+    m_index.build(handle, m_map, m_mapSize);
+    return true;
+}
+
+qint64 ArchiveReader::dataOffset(const ArchiveEntry& entry) const{
+    if(!m_map)
+        return -1;
+    return ArchiveIndex::dataOffset(m_map, m_mapSize, entry);
+}
+
+bool ArchiveReader::readStored(const ArchiveEntry& entry, QByteArray* data) const{
+    if(entry.CompressionMethod != ZIP_CM_STORE || entry.EncryptionMethod != ZIP_EM_NONE ||
+        entry.CompressedSize != entry.Size)
+        return false;
+    qint64 offset = dataOffset(entry);
+    if(offset < 0)
+        return false;
+    *data = QByteArray((const char*)m_map + offset, (qsizetype)entry.Size);
+    return true;
+}
+
+bool ArchiveReader::read(const ArchiveEntry& entry, QByteArray* data){
+    if(!(entry.Valid & ZIP_STAT_SIZE) || entry.Size > (quint64)std::numeric_limits<int>::max())
+        return false;
+    if(readStored(entry, data))
+        return true;
+    std::unique_ptr<Stream> stream = openStream(entry);
+    if(!stream)
+        return false;
+    QByteArray result(qsizetype(entry.Size), Qt::Uninitialized);
+    zip_uint64_t sum = 0;
+    while(sum != entry.Size){
+        zip_int64_t len = stream->read(result.data() + sum, entry.Size - sum);
+        if(len <= 0)
+            return false;
+        sum += (zip_uint64_t)len;
+    }
+    *data = result;
+    return true;
+}
+
+// The index is a snapshot of the first handle's central directory. A handle
+// opened later on a replaced file can hold another entry at the same index,
+// whose own CRC check would still pass.
+static bool MatchesEntry(struct zip* handle, const ArchiveEntry& entry){
+    struct zip_stat zs;
+    zip_stat_init(&zs);
+    if(zip_stat_index(handle, entry.Index, 0, &zs) || !(zs.valid & ZIP_STAT_NAME) ||
+        QString::fromUtf8(zs.name) != entry.Name || (zs.valid & ZIP_STAT_SIZE) != (entry.Valid & ZIP_STAT_SIZE) ||
+        (zs.valid & ZIP_STAT_CRC) != (entry.Valid & ZIP_STAT_CRC))
+        return false;
+    if((zs.valid & ZIP_STAT_SIZE) && zs.size != entry.Size)
+        return false;
+    if((zs.valid & ZIP_STAT_CRC) && zs.crc != entry.Crc)
+        return false;
+    return true;
+}
+
+std::unique_ptr<ArchiveReader::Stream> ArchiveReader::openStream(const ArchiveEntry& entry){
+    struct zip* handle = acquireHandle();
+    if(!handle)
+        return nullptr;
+    if(!MatchesEntry(handle, entry)){
+        releaseHandle(handle);
+        return nullptr;
+    }
+    struct zip_file* file = zip_fopen_index(handle, entry.Index, 0);
+    if(!file){
+        releaseHandle(handle);
+        return nullptr;
+    }
+    return std::unique_ptr<Stream>(new Stream(this, handle, file));
+}
+
+struct zip* ArchiveReader::acquireHandle(){
+    QMutexLocker locker(&m_handlesMutex);
+    while(m_freeHandles.empty()){
+        if((int)m_handles.size() < m_maxHandles){
+            int z_err;
+            struct zip* handle = zip_open(m_path.toStdString().c_str(), ZIP_RDONLY, &z_err);
+            if(handle){
+                m_handles.push_back(handle);
+                return handle;
+            }
+            if(m_handles.empty())
+                return nullptr;
+            m_maxHandles = (int)m_handles.size();
+        }
+        m_handleReleased.wait(&m_handlesMutex);
+    }
+    struct zip* handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+    return handle;
+}
+
+void ArchiveReader::releaseHandle(struct zip* handle){
+    QMutexLocker locker(&m_handlesMutex);
+    m_freeHandles.push_back(handle);
+    m_handleReleased.wakeOne();
+}
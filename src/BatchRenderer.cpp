@@ -0,0 +1,166 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#include <BatchRenderer.hpp>
+#include <Presentation.hpp>
+#include <SlideRenderer.hpp>
+#include <Trace.hpp>
+#include <string.h>
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+
+BatchRenderer::BatchRenderer(const BatchRenderOptions& options) : m_options(options) {
+    if(m_options.Threads < 1)
+        m_options.Threads = 1;
+}
+
+bool BatchRenderer::IsBatchInvocation(int argc, char** argv){
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "--render") || !strncmp(argv[i], "--render=", 9))
+            return true;
+    }
+    return false;
+}
+
+bool BatchRenderer::ParseArguments(const QStringList& arguments, BatchRenderOptions* options, QString* error){
+    QCommandLineParser parser;
+    QCommandLineOption renderOption("render", "Render every slide of <deck> without opening a window.", "deck");
+    QCommandLineOption outputOption("output", "Output directory for PNG files, or a .pdf file.", "path");
+    QCommandLineOption sizeOption("size", "Slide size in pixels (default 1920x1080).", "WxH");
+    QCommandLineOption threadsOption("threads", "Number of render threads (default: core count).", "n");
+    QCommandLineOption traceOption("trace", "Write a Chrome JSON trace to <file>.", "file");
+    parser.addOptions({ renderOption, outputOption, sizeOption, threadsOption, traceOption });
+    if(!parser.parse(arguments)){
+        *error = parser.errorText();
+        return false;
+    }
+    options->InputPath = parser.value(renderOption);
+    options->OutputPath = parser.value(outputOption);
+    if(options->InputPath.isEmpty() || options->OutputPath.isEmpty()){
+        *error = "Usage: --render <deck.spres> --output <directory|file.pdf> [--size WxH] [--threads n]";
+        return false;
+    }
+    options->Pdf = options->OutputPath.endsWith(".pdf", Qt::CaseInsensitive);
+    if(parser.isSet(sizeOption)){
+        QStringList size = parser.value(sizeOption).toLower().split('x');
+        bool okWidth = false, okHeight = false;
+        if(size.size() == 2)
+            options->Size = QSize(size[0].toInt(&okWidth), size[1].toInt(&okHeight));
+        if(!okWidth || !okHeight || options->Size.isEmpty()){
+            *error = "Invalid --size value, expected WxH (e.g. 1920x1080).";
+            return false;
+        }
+    }
+    if(parser.isSet(threadsOption)){
+        bool ok = false;
+        options->Threads = parser.value(threadsOption).toInt(&ok);
+        if(!ok || options->Threads < 1){
+            *error = "Invalid --threads value.";
+            return false;
+        }
+    }
+    return true;
+}
+
+int BatchRenderer::Run(const QStringList& arguments){
+    BatchRenderOptions options;
+    QString error;
+    if(!ParseArguments(arguments, &options, &error)){
+        fprintf(stderr, "[ERROR] %s\n", error.toStdString().c_str());
+        return 2;
+    }
+    return BatchRenderer(options).Execute();
+}
+
+int BatchRenderer::Execute(){
+    QElapsedTimer timer;
+    timer.start();
+    std::unique_ptr<Presentation> presentation;
+    try{
+        presentation.reset(new Presentation(m_options.InputPath, PresentationLoadMode::streaming));
+    }
+    catch(PresentationException& e){
+        fprintf(stderr, "[ERROR] Failed to Load Presentation: %s\n", e.what());
+        return 1;
+    }
+    if(!m_options.Pdf && !QDir().mkpath(m_options.OutputPath)){
+        fprintf(stderr, "[ERROR] Failed to create output directory: %s\n", m_options.OutputPath.toStdString().c_str());
+        return 1;
+    }
+    qint64 loadTime = timer.elapsed();
+
+    size_t slideCount = presentation->SlideCount();
+    size_t chunkSize = (size_t)m_options.Threads * 4;
+    std::vector<QImage> frames(m_options.Pdf ? chunkSize : 0);
+    std::atomic<int> failures(0);
+    QPdfWriter* writer = nullptr;
+    QPainter painter;
+    if(m_options.Pdf){
+        writer = new QPdfWriter(m_options.OutputPath);
+        writer->setResolution(72);
+        writer->setPageSize(QPageSize(QSizeF(m_options.Size), QPageSize::Point, QString(), QPageSize::ExactMatch));
+        writer->setPageMargins(QMarginsF(0, 0, 0, 0));
+        writer->setTitle(presentation->Title);
+        if(!painter.begin(writer)){
+            fprintf(stderr, "[ERROR] Failed to write %s\n", m_options.OutputPath.toStdString().c_str());
+            delete writer;
+            return 1;
+        }
+    }
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_options.Threads);
+    for(size_t first = 0; first < slideCount; first += chunkSize){
+        size_t last = qMin(first + chunkSize, slideCount);
+        for(size_t i = first; i < last; i++){
+            pool.start([this, i, first, &presentation, &frames, &failures](){
+                TRACE_SCOPE("BatchRenderer::renderSlide", "render");
+                SlideRenderer renderer;
+                renderer.setSlide(presentation->GetSlide(i), m_options.Size);
+                renderer.loadImages(presentation.get());
+                QImage frame = renderer.render();
+                if(m_options.Pdf){
+                    frames[i - first] = frame;
+                    return;
+                }
+                QString fileName = QString("slide-%1.png").arg(i + 1, 4, 10, QChar('0'));
+                if(!frame.save(QDir(m_options.OutputPath).filePath(fileName), "PNG")){
+                    fprintf(stderr, "[ERROR] Failed to write %s\n", fileName.toStdString().c_str());
+                    failures++;
+                }
+            });
+        }
+        pool.waitForDone();
+        for(size_t i = first; writer && i < last; i++){
+            if(i)
+                writer->newPage();
+            painter.drawImage(QRect(QPoint(0, 0), m_options.Size), frames[i - first]);
+            frames[i - first] = QImage();
+        }
+    }
+    if(writer){
+        painter.end();
+        delete writer;
+    }
+
+    qint64 totalTime = qMax<qint64>(timer.elapsed(), 1);
+    qint64 renderTime = qMax<qint64>(totalTime - loadTime, 1);
+    printf("Rendered %zu slides at %dx%d on %d threads in %.3f s (load %.3f s, %.1f slides/s)\n",
+           slideCount, m_options.Size.width(), m_options.Size.height(), m_options.Threads,
+           totalTime / 1000.0, loadTime / 1000.0, slideCount * 1000.0 / renderTime);
+    return failures.load() ? 1 : 0;
+}
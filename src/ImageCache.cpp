@@ -0,0 +1,140 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#include <ImageCache.hpp>
+
+ImageCache::ImageCache(qint64 maxBytes){
+    m_cache.setMaxCost(maxBytes);
+}
+
+void ImageCache::setMaxBytes(qint64 maxBytes){
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(maxBytes);
+}
+
+qint64 ImageCache::maxBytes() const{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+qint64 ImageCache::usedBytes() const{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.totalCost();
+}
+
+quint64 ImageCache::sizeKey(const QSize& size){
+    return ((quint64)(quint32)size.width() << 32) | (quint32)size.height();
+}
+
+bool ImageCache::find(const QString& key, QImage* image){
+    QMutexLocker locker(&m_mutex);
+    Entry* entry = m_cache.object(key);
+    if(!entry || entry->Image.isNull())
+        return false;
+    *image = entry->Image;
+    return true;
+}
+
+bool ImageCache::find(const QString& key, const QSize& size, QImage* image){
+    QMutexLocker locker(&m_mutex);
+    Entry* entry = m_cache.object(key);
+    if(!entry)
+        return false;
+    auto it = entry->Scaled.constFind(sizeKey(size));
+    if(it == entry->Scaled.constEnd())
+        return false;
+    *image = it.value();
+    return true;
+}
+
+void ImageCache::insertEntry(const QString& key, Entry* entry){
+    entry->Bytes = entry->Image.sizeInBytes();
+    for(const QImage& scaled : std::as_const(entry->Scaled))
+        entry->Bytes += scaled.sizeInBytes();
+    entry->Sizes = &m_sizes;
+    entry->Key = key;
+    entry->Sequence = ++m_insertions;
+    m_sizes.insert(key, entry->Bytes);
+    m_cache.insert(key, entry, qMax<qint64>(entry->Bytes, 1));
+}
+
+void ImageCache::insert(const QString& key, const QImage& image){
+    QMutexLocker locker(&m_mutex);
+    Entry* entry = m_cache.take(key);
+    if(!entry)
+        entry = new Entry;
+    entry->Image = image;
+    insertEntry(key, entry);
+}
+
+void ImageCache::insertScaled(const QString& key, const QSize& size, const QImage& image){
+    QMutexLocker locker(&m_mutex);
+    Entry* entry = m_cache.take(key);
+    if(!entry)
+        entry = new Entry;
+    entry->Scaled.insert(sizeKey(size), image);
+    insertEntry(key, entry);
+}
+
+std::vector<std::pair<QString, qint64>> ImageCache::entries() const{
+    QMutexLocker locker(&m_mutex);
+    std::vector<std::pair<QString, qint64>> result;
+    result.reserve(m_sizes.size());
+    for(auto it = m_sizes.constBegin(); it != m_sizes.constEnd(); it++)
+        result.emplace_back(it.key(), it.value());
+    return result;
+}
+
+void ImageCache::remove(const QString& key){
+    QMutexLocker locker(&m_mutex);
+    m_cache.remove(key);
+}
+
+// Counts every insert so far; an entry remembers the count of its latest one.
+quint64 ImageCache::insertions() const{
+    QMutexLocker locker(&m_mutex);
+    return m_insertions;
+}
+
+// Copies the entries of another cache that pass keep() and were last written
+// no later than insert number insertedUpTo; the images are implicitly
+// shared, so nothing is decoded or copied pixel by pixel.
+void ImageCache::adopt(ImageCache* other, const std::function<bool(const QString&)>& keep, quint64 insertedUpTo){
+    std::vector<std::pair<QString, Entry*>> adopted;
+    {
+        QMutexLocker locker(&other->m_mutex);
+        for(const QString& key : other->m_cache.keys()){
+            Entry* entry = other->m_cache.object(key);
+            if(!entry || entry->Sequence > insertedUpTo || !keep(key))
+                continue;
+            Entry* copy = new Entry;
+            copy->Image = entry->Image;
+            copy->Scaled = entry->Scaled;
+            adopted.emplace_back(key, copy);
+        }
+    }
+    QMutexLocker locker(&m_mutex);
+    for(const std::pair<QString, Entry*>& entry : adopted){
+        delete m_cache.take(entry.first);
+        insertEntry(entry.first, entry.second);
+    }
+}
+
+void ImageCache::clear(){
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
@@ -0,0 +1,232 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#include <ImageDecoder.hpp>
+#include <Presentation.hpp>
+#include <Trace.hpp>
+
+// Counters of the token whose request this decode thread is serving, if any.
+static thread_local ImageDecoderCounters* t_requestCounters = nullptr;
+
+ImageDecoder::ImageDecoder(ImageEntryReader reader, ImageCache* cache)
+    : m_reader(reader), m_cache(cache), m_generation(0) {
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+ImageDecoder::~ImageDecoder(){
+    cancelAll();
+    m_pool.waitForDone();
+}
+
+QImage ImageDecoder::decode(const QByteArray& data, const QSize& size){
+    TRACE_SCOPE("ImageDecoder::decode", "image");
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    // Only libjpeg scales for free, by 1/2, 1/4 or 1/8 inside the IDCT; stop
+    // at the last step that still covers the target and let scale() finish.
+    // Other formats decode at full size and are scaled by scale() as well.
+    if(!size.isEmpty() && reader.format() == "jpeg" && reader.supportsOption(QImageIOHandler::ScaledSize)){
+        QSize source = reader.size();
+        int denominator = 1;
+        while(denominator < 8 && (source.width() + denominator * 2 - 1) / (denominator * 2) >= size.width() &&
+              (source.height() + denominator * 2 - 1) / (denominator * 2) >= size.height())
+            denominator *= 2;
+        if(denominator > 1)
+            reader.setScaledSize(QSize((source.width() + denominator - 1) / denominator,
+                                       (source.height() + denominator - 1) / denominator));
+    }
+    return reader.read();
+}
+
+// A 1/8 DCT decode of a large JPEG costs a fraction of the full decode and
+// is good enough to paint while the full-quality image is prepared.
+QImage ImageDecoder::decodePreview(const QByteArray& data, const QSize& size){
+    TRACE_SCOPE("ImageDecoder::decodePreview", "image");
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    QSize source = reader.size();
+    if(size.isEmpty() || reader.format() != "jpeg" || !reader.supportsOption(QImageIOHandler::ScaledSize) ||
+        (qint64)source.width() * source.height() < PreviewSourcePixels ||
+        (qint64)source.width() * source.height() < 4 * (qint64)size.width() * size.height())
+        return QImage();
+    reader.setScaledSize(QSize((source.width() + 7) / 8, (source.height() + 7) / 8));
+    return reader.read();
+}
+
+QImage ImageDecoder::decodeScaled(const QString& name, const QByteArray& data, const QSize& size){
+    QElapsedTimer timer;
+    timer.start();
+    QImage decoded = decode(data, size);
+    qint64 decodeNs = timer.nsecsElapsed();
+    count(&ImageDecoderCounters::DecodeNs, decodeNs);
+    QImage scaled = scale(decoded, size);
+    count(&ImageDecoderCounters::ScaleNs, timer.nsecsElapsed() - decodeNs);
+    count(&ImageDecoderCounters::Images, 1);
+    if(!scaled.isNull())
+        m_cache->insertScaled(name, size, scaled);
+    return scaled;
+}
+
+void ImageDecoder::count(std::atomic<qint64> ImageDecoderCounters::* counter, qint64 value){
+    (m_counters.*counter).fetch_add(value);
+    if(t_requestCounters)
+        (t_requestCounters->*counter).fetch_add(value);
+}
+
+QByteArray ImageDecoder::read(const QString& name){
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray data = m_reader(name);
+    count(&ImageDecoderCounters::ReadNs, timer.nsecsElapsed());
+    return data;
+}
+
+// Averages each 2x2 block, two channels per 32-bit word at a time. Only
+// used on RGB32 and premultiplied ARGB32, where channels average linearly.
+QImage ImageDecoder::halve(const QImage& image){
+    QImage result(image.width() / 2, image.height() / 2, image.format());
+    if(result.isNull())
+        return image;
+    for(int y = 0; y < result.height(); y++){
+        const quint32* top = (const quint32*)image.constScanLine(y * 2);
+        const quint32* bottom = (const quint32*)image.constScanLine(y * 2 + 1);
+        quint32* out = (quint32*)result.scanLine(y);
+        for(int x = 0; x < result.width(); x++){
+            quint32 a = top[x * 2], b = top[x * 2 + 1], c = bottom[x * 2], d = bottom[x * 2 + 1];
+            quint32 rb = (a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF);
+            quint32 ag = ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF) +
+                         ((c >> 8) & 0x00FF00FF) + ((d >> 8) & 0x00FF00FF);
+            out[x] = (((rb + 0x00020002) >> 2) & 0x00FF00FF) | ((((ag + 0x00020002) >> 2) & 0x00FF00FF) << 8);
+        }
+    }
+    return result;
+}
+
+QImage ImageDecoder::scale(const QImage& image, const QSize& size){
+    if(size.isEmpty() || image.isNull() || image.size() == size)
+        return image;
+    TRACE_SCOPE("ImageDecoder::scale", "image");
+    // Box-filter halving down to within 2x of the target is much cheaper than
+    // one large smooth scale and leaves the final pass a small, sharp step.
+    QImage scaled = image;
+    if(scaled.width() >= size.width() * 2 && scaled.height() >= size.height() * 2){
+        if(scaled.format() != QImage::Format_RGB32 && scaled.format() != QImage::Format_ARGB32_Premultiplied)
+            scaled = scaled.convertToFormat(scaled.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+        while(scaled.width() >= size.width() * 2 && scaled.height() >= size.height() * 2)
+            scaled = halve(scaled);
+    }
+    if(scaled.size() == size)
+        return scaled;
+    return scaled.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+QImage ImageDecoder::image(const QString& name){
+    QImage image;
+    if(m_cache->find(name, &image))
+        return image;
+    QByteArray data = read(name);
+    QElapsedTimer timer;
+    timer.start();
+    image = decode(data);
+    count(&ImageDecoderCounters::DecodeNs, timer.nsecsElapsed());
+    count(&ImageDecoderCounters::Images, 1);
+    if(!image.isNull())
+        m_cache->insert(name, image);
+    return image;
+}
+
+QImage ImageDecoder::image(const QString& name, const QSize& size){
+    if(size.isEmpty())
+        return image(name);
+    QImage scaled;
+    if(m_cache->find(name, size, &scaled))
+        return scaled;
+    // The full-size decode is dropped once scaled; only the on-screen size is kept.
+    QImage original;
+    if(!m_cache->find(name, &original))
+        return decodeScaled(name, read(name), size);
+    QElapsedTimer timer;
+    timer.start();
+    scaled = scale(original, size);
+    count(&ImageDecoderCounters::ScaleNs, timer.nsecsElapsed());
+    if(!scaled.isNull())
+        m_cache->insertScaled(name, size, scaled);
+    return scaled;
+}
+
+void ImageDecoder::request(const QString& name, const QSize& size, const ImageRequestToken& token,
+                           QObject* context, ImageCallback callback){
+    QPointer<QObject> guard(context);
+    quint64 generation = m_generation.load();
+    m_pool.start([this, name, size, token, guard, callback, generation](){
+        if(token.isCancelled() || generation != m_generation.load())
+            return;
+        TRACE_SCOPE("ImageDecoder::request", "image");
+        struct RequestCounters
+        {
+            RequestCounters(ImageDecoderCounters* counters) { t_requestCounters = counters; }
+            ~RequestCounters() { t_requestCounters = nullptr; }
+        } requestCounters(&token.counters());
+        auto deliver = [guard, callback, token](const QImage& result, const QString& error, bool preview){
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, callback, result, error, token, preview](){
+                if(guard && !token.isCancelled())
+                    callback(result, error, preview);
+            }, Qt::QueuedConnection);
+        };
+        QImage result;
+        QString error;
+        try{
+            QImage original;
+            if(!size.isEmpty() && !m_cache->find(name, size, &result) && !m_cache->find(name, &original)){
+                QByteArray data = read(name);
+                QElapsedTimer timer;
+                timer.start();
+                QImage preview = decodePreview(data, size);
+                count(&ImageDecoderCounters::DecodeNs, timer.nsecsElapsed());
+                if(!preview.isNull() && !token.isCancelled() && generation == m_generation.load())
+                    deliver(preview, QString(), true);
+                result = decodeScaled(name, data, size);
+            }
+            else if(result.isNull()){
+                result = image(name, size);
+            }
+            if(result.isNull())
+                error = "Unsupported or corrupted image data";
+        }
+        catch(const PresentationException& e){
+            error = e.what();
+        }
+        if(token.isCancelled() || generation != m_generation.load())
+            return;
+        deliver(result, error, false);
+    });
+}
+
+void ImageDecoder::cancelAll(){
+    m_generation++;
+    m_pool.clear();
+}
+
+// Cancels like cancelAll() and also waits for requests already running.
+void ImageDecoder::drain(){
+    cancelAll();
+    m_pool.waitForDone();
+}
@@ -92,26 +92,10 @@ void MainWindow::HandleOpenAboutAction(){
 }
 
 void MainWindow::HandleOpenFile(){
-    Presentation* pres = nullptr;
     QString filePath = QFileDialog::getOpenFileName(this, "Open .spres presentation", QDir::homePath(), ".spres files (*.spres)");
     if(!filePath.isEmpty()){
-        try{
-            pres = new Presentation(filePath);
-        }
-        catch (PresentationException e){
-            QMessageBox *messageBox = new QMessageBox(this);
-            messageBox->setWindowTitle("Failed to Load Presentation");
-            messageBox->setText(QString("Failed to Load Presentation:\n   " + QString(e.what())));
-            messageBox->show();
-            return;
-        }
         Application* app = static_cast<Application*>(QApplication::instance());
-        if(app->presentationWindow)
-            app->presentationWindow->close();
-        app->presentationWindow = new PresentationWindow();
-        this->hide();
-        app->presentationWindow->setPresentation(pres);
-        app->presentationWindow->showFullScreen();
+        app->OpenPresentation(filePath);
     }
 }
 
@@ -16,9 +16,12 @@
 // see <https://www.gnu.org/licenses/>.
 
 #include <Presentation.hpp>
+#include <SlideModelCache.hpp>
+#include <Trace.hpp>
 #include <vendor/RapidXML/rapidxml.hpp>
-
-#define BUF_LENGTH 64
+#include <charconv>
+#include <limits>
+#include <stdio.h>
 
 bool DoesFileExist(const char* file_name){
      if (FILE *file = fopen(file_name, "r")) {
@@ -29,23 +32,103 @@ bool DoesFileExist(const char* file_name){
     }   
 }
 
-static char* GetAttributeValue(const char* name, rapidxml::xml_node<> *node){
+struct XMLValue
+{
+    const char* Data;
+    size_t Size;
+};
+
+struct UnitKeyword
+{
+    const char* Suffix;
+    size_t Length;
+    SizeType Type;
+};
+
+struct AlignmentKeyword
+{
+    const char* Keyword;
+    size_t Length;
+    int Flag;
+};
+
+static constexpr UnitKeyword UnitKeywords[] = {
+    { "px", 2, SizeType::pixels },
+    { "%", 1, SizeType::percent },
+    { "pt", 2, SizeType::points }
+};
+
+static constexpr AlignmentKeyword HorizontalKeywords[] = {
+    { "left", 4, Qt::AlignLeft },
+    { "center", 6, Qt::AlignHCenter },
+    { "middle", 6, Qt::AlignHCenter },
+    { "right", 5, Qt::AlignRight }
+};
+
+static constexpr AlignmentKeyword VerticalKeywords[] = {
+    { "top", 3, Qt::AlignTop },
+    { "center", 6, Qt::AlignVCenter },
+    { "middle", 6, Qt::AlignVCenter },
+    { "bottom", 6, Qt::AlignBottom }
+};
+
+static inline char ToLowerASCII(char c){
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+static bool ContainsNoCase(const XMLValue& value, const char* keyword, size_t length){
+    if(value.Size < length)
+        return false;
+    for(size_t i = 0; i + length <= value.Size; i++){
+        size_t j = 0;
+        while(j < length && ToLowerASCII(value.Data[i + j]) == keyword[j])
+            j++;
+        if(j == length)
+            return true;
+    }
+    return false;
+}
+
+static inline QString ToQString(const XMLValue& value){
+    return QString::fromUtf8(value.Data, (qsizetype)value.Size);
+}
+
+static XMLValue GetAttributeValue(const char* name, rapidxml::xml_node<> *node){
     if(!node)
-        return new char[1]{0};
+        return { "", 0 };
     rapidxml::xml_attribute<char> *attrib = node->first_attribute(name, 0UL, false);
     if(!attrib)
-        return new char[1]{0}; 
-    char* attrib_val = attrib->value();
-    return attrib_val;
+        return { "", 0 };
+    return { attrib->value(), attrib->value_size() };
 }
 
-static char* GetValue(const char* name, rapidxml::xml_node<> *parent_node){
+static XMLValue GetValue(const char* name, rapidxml::xml_node<> *parent_node){
     if(!parent_node)
-        return new char[1]{0};
+        return { "", 0 };
     rapidxml::xml_node<> *node = parent_node->first_node(name, 0UL, false);
     if(!node)
-        return new char[1]{0};
-    return node->value();
+        return { "", 0 };
+    return { node->value(), node->value_size() };
+}
+
+// Accepts what std::stoi accepts before the first invalid character, without throwing.
+static bool ParseInt(const char* begin, const char* end, int base, int* value){
+    while(begin != end && isspace((unsigned char)*begin))
+        begin++;
+    if(end - begin > 1 && begin[0] == '+' && begin[1] != '-')
+        begin++;
+    std::from_chars_result result = std::from_chars(begin, end, *value, base);
+    if(result.ec != std::errc()){
+        *value = 0;
+        return false;
+    }
+    return true;
+}
+
+static bool ParseNumber(const char* begin, const char* end, int* value){
+    if(end - begin > 2 && begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X'))
+        return ParseInt(begin + 2, end, 16, value);
+    return ParseInt(begin, end, 10, value);
 }
 
 static int GetAlignmentFlags(rapidxml::xml_node<> *node){
@@ -55,170 +138,418 @@ static int GetAlignmentFlags(rapidxml::xml_node<> *node){
     rapidxml::xml_node<> *horizontal_node = NULL;
     rapidxml::xml_node<> *vertical_node = NULL;
     horizontal_node = node->first_node("horizontal", 0UL, false);
+    int flag = Qt::AlignHCenter;
     if(horizontal_node){
-        QString str = QString(horizontal_node->value());
-        str = str.toLower();
-        if(str.contains("left"))
-            align |= Qt::AlignLeft;
-        else if(str.contains("center") || str.contains("middle"))
-            align |= Qt::AlignHCenter;
-        else if(str.contains("right"))
-            align |= Qt::AlignRight;
-        else
-            align |= Qt::AlignHCenter;
-    }
-    else
-        align |= Qt::AlignHCenter;
+        XMLValue value = { horizontal_node->value(), horizontal_node->value_size() };
+        for(const AlignmentKeyword& keyword : HorizontalKeywords){
+            if(ContainsNoCase(value, keyword.Keyword, keyword.Length)){
+                flag = keyword.Flag;
+                break;
+            }
+        }
+    }
+    align |= flag;
     vertical_node = node->first_node("vertical", 0UL, false);
+    flag = vertical_node ? Qt::AlignHCenter : Qt::AlignVCenter;
     if(vertical_node){
-        QString str = QString(vertical_node->value());
-        str = str.toLower();
-        if(str.contains("top"))
-            align |= Qt::AlignTop;
-        else if(str.contains("center") || str.contains("middle"))
-            align |= Qt::AlignVCenter;
-        else if(str.contains("bottom"))
-            align |= Qt::AlignBottom;
-        else
-            align |= Qt::AlignHCenter;
-    }
-    else
-        align |= Qt::AlignVCenter;
+        XMLValue value = { vertical_node->value(), vertical_node->value_size() };
+        for(const AlignmentKeyword& keyword : VerticalKeywords){
+            if(ContainsNoCase(value, keyword.Keyword, keyword.Length)){
+                flag = keyword.Flag;
+                break;
+            }
+        }
+    }
+    align |= flag;
     return align;
 }
 
 static int GetIntValue(const char* name, rapidxml::xml_node<> *parent_node){
-    char* str = GetValue(name, parent_node);
-    if(strlen(str) > 2){
-        if(str[0] == '0' && (str[1] == 'x' || str[1] == 'X')){
-            str += 2;
-            try{
-                return std::stoi(str, nullptr, 16);
-            }
-            catch(std::exception&){
-                return 0;
+    XMLValue str = GetValue(name, parent_node);
+    int value = 0;
+    ParseNumber(str.Data, str.Data + str.Size, &value);
+    return value;
+}
+
+static bool GetBooleanValue(const char* name, rapidxml::xml_node<> *parent_node){
+    XMLValue str = GetValue(name, parent_node);
+    return str.Size == 4 && ContainsNoCase(str, "true", 4);
+}
+
+static void GetIntValue(const char* name, rapidxml::xml_node<> *parent_node, int* value, SizeType *type){
+    XMLValue str = GetValue(name, parent_node);
+    const char* end = str.Data + str.Size;
+    if(type){
+        *type = SizeType::none;
+        for(const UnitKeyword& unit : UnitKeywords){
+            if(str.Size >= unit.Length && !memcmp(end - unit.Length, unit.Suffix, unit.Length)){
+                *type = unit.Type;
+                end -= unit.Length;
+                break;
             }
         }
     }
-    try{
-        return std::stoi(str, nullptr, 10);
+    if(!ParseNumber(str.Data, end, value) && type)
+        *type = SizeType::none;
+}
+
+#pragma region PARSING
+
+static void ParseSlide(rapidxml::xml_node<> *slide_node, PresentationSlideStore* store, PresentationSlide* slide){
+    TRACE_SCOPE("ParseSlide", "load");
+    rapidxml::xml_node<> *image_node = NULL;
+    rapidxml::xml_node<> *text_node = NULL;
+    rapidxml::xml_node<> *temp_node = NULL;
+    std::vector<PresentationImage> images;
+    std::vector<PresentationText> texts;
+    slide->SlideTitle = ToQString(GetAttributeValue("Title", slide_node));
+    temp_node = slide_node->first_node("SlideBackground");
+    slide->SlideBackgroundFileName = store->Strings.intern(ToQString(GetAttributeValue("Filename", temp_node)));
+    if(slide->SlideBackgroundFileName.isEmpty()){
+        if(temp_node){
+            temp_node = temp_node->first_node("Color", 0UL, false);
+            union {
+                uint32_t RGBA;
+                uint8_t bytes[4];
+            } RGBA;
+            RGBA.bytes[0] = (uint8_t)GetIntValue("r", temp_node);
+            RGBA.bytes[1] = (uint8_t)GetIntValue("g", temp_node);
+            RGBA.bytes[2] = (uint8_t)GetIntValue("b", temp_node);
+            RGBA.bytes[3] = 255;
+            slide->SlideBackgroundColor = RGBA.RGBA;
+            slide->hasBackgroundColor = true;
+        }
     }
-    catch(std::exception&){
-        return 0;
+
+    image_node = slide_node->first_node("Image", 0UL, false);
+    while(image_node){
+        PresentationImage image;
+        image.Alt = store->Strings.intern(ToQString(GetValue("Alt", image_node)));
+        image.FileName = store->Strings.intern(ToQString(GetAttributeValue("Filename", image_node)));
+        int x, y;
+        SizeType x_type, y_type;
+        temp_node = image_node->first_node("size", 0UL, false);
+        GetIntValue("width", temp_node, &x, &x_type);
+        GetIntValue("height", temp_node, &y, &y_type);
+        image.Size_type[0] = x_type;
+        image.Size_type[1] = y_type;
+        image.Size = QSize(x, y);
+        temp_node = image_node->first_node("position", 0UL, false);
+        GetIntValue("x", temp_node, &x, &x_type);
+        GetIntValue("y", temp_node, &y, &y_type);
+        image.Position_type[0] = x_type;
+        image.Position_type[1] = y_type;
+        image.Position = QPoint(x, y);
+        images.push_back(image);
+        image_node = image_node->next_sibling(image_node->name(), image_node->name_size(), false);
     }
-    return 0;
+
+    text_node = slide_node->first_node("Text", 0UL, false);
+    while(text_node){
+        PresentationText text;
+        text.Text = ToQString(GetValue("String", text_node));
+        text.Text.replace("\\n", "\n");
+        if(text.Text.isEmpty()){
+            text.Text = ToQString(GetAttributeValue("String", text_node));
+            text.Text.replace("\\n", "\n");
+        }
+        text.Text = store->Strings.intern(text.Text);
+        text.isBold = false;
+        text.isItalic = false;
+        text.isStrikedOut = false;
+        text.isUnderlined = false;
+
+        text.Alignment = GetAlignmentFlags(text_node->first_node("Alignment", 0UL, false));
+
+        temp_node = text_node->first_node("Font", 0UL, false);
+        GetIntValue("Size", temp_node, &text.fontSize, &text.fontSizeType);
+        if(temp_node)
+            temp_node = temp_node->first_node("Color", 0UL, false);
+        union {
+            uint32_t RGBA;
+            uint8_t bytes[4];
+        } RGBA;
+        RGBA.bytes[0] = (uint8_t)GetIntValue("r", temp_node);
+        RGBA.bytes[1] = (uint8_t)GetIntValue("g", temp_node);
+        RGBA.bytes[2] = (uint8_t)GetIntValue("b", temp_node);
+        RGBA.bytes[3] = 255;
+        text.FontColor = RGBA.RGBA;
+        int x, y;
+        SizeType x_type, y_type;
+        temp_node = text_node->first_node("size", 0UL, false);
+        GetIntValue("width", temp_node, &x, &x_type);
+        GetIntValue("height", temp_node, &y, &y_type);
+        text.Size_type[0] = x_type;
+        text.Size_type[1] = y_type;
+        text.Size = QSize(x, y);
+        temp_node = text_node->first_node("position", 0UL, false);
+        GetIntValue("x", temp_node, &x, &x_type);
+        GetIntValue("y", temp_node, &y, &y_type);
+        text.Position_type[0] = x_type;
+        text.Position_type[1] = y_type;
+        text.Position = QPoint(x, y);
+
+        texts.push_back(text);
+        text_node = text_node->next_sibling(text_node->name(), text_node->name_size(), false);
+    }
+    slide->Images = store->Images.allocate(images);
+    slide->Texts = store->Texts.allocate(texts);
 }
 
-static bool GetBooleanValue(const char* name, rapidxml::xml_node<> *parent_node){
-    char* str = GetValue(name, parent_node);
-    int i = 0;
-    while(str[i]){
-        str[i] = tolower(str[i]);
-        i++;
+static const char* SkipPast(const char* text, const char* end, const char* token){
+    size_t length = strlen(token);
+    for(; text + length <= end; text++){
+        if(!memcmp(text, token, length))
+            return text + length;
     }
-    if(!strcmp(str, "true"))
-        return true;
-    return false;
+    return nullptr;
 }
 
-static void GetIntValue(const char* name, rapidxml::xml_node<> *parent_node, int* value, SizeType *type){
-    QString qstr = GetValue(name, parent_node);
-    if(type){
-        if(qstr.endsWith("px")){
-            *type = SizeType::pixels;
-            qstr.remove(qstr.length() - 2, 2);
+static const char* FindTagEnd(const char* text, const char* end){
+    char quote = 0;
+    for(; text < end; text++){
+        if(quote){
+            if(*text == quote)
+                quote = 0;
         }
-        else if(qstr.endsWith("%")){
-            *type = SizeType::percent;
-            qstr.remove(qstr.length() - 1, 1);
+        else if(*text == '"' || *text == '\''){
+            quote = *text;
         }
-        else if(qstr.endsWith("pt")){
-            *type = SizeType::points;
-            qstr.remove(qstr.length() - 2, 2);
-        }
-        else{
-            *type = SizeType::none;
+        else if(*text == '>'){
+            return text;
         }
     }
-    if(qstr.length() > 2){
-        qstr = qstr.toLower();
-        if(qstr.at(0) == '0' && qstr.at(1) == 'x'){
-            qstr.remove(0, 2);
-            
-            try{
-                *value = std::stoi(qstr.toStdString()  , nullptr, 16);
+    return nullptr;
+}
+
+static bool NameEquals(const char* name, const char* nameEnd, const char* expected){
+    size_t length = strlen(expected);
+    return (size_t)(nameEnd - name) == length && !qstrnicmp(name, expected, length);
+}
+
+struct SlideScanState
+{
+    size_t Position = 0;
+    size_t SlideBegin = 0;
+    int Depth = 0;
+    bool InSlide = false;
+    bool RootFound = false;
+    bool InRoot = false;
+    bool SlidesStarted = false;
+};
+
+// Finds the root start tag and the range of every slide element without
+// building a DOM, mirroring the node selection of the eager parser. Unless
+// final is set, a construct cut off by the end of the buffer is left for the
+// next call so the buffer can be fed in chunks.
+template<typename RootCallback, typename SlideCallback>
+static bool ScanSlides(const char* xml, size_t size, bool final, SlideScanState* state,
+                       RootCallback onRoot, SlideCallback onSlide){
+    const char *text = xml + state->Position, *end = xml + size;
+    while((text = (const char*)memchr(text, '<', end - text))){
+        const char* tag = text;
+        if(!final && end - text < 9)
+            break;
+        if(end - text >= 4 && !memcmp(text, "<!--", 4)){
+            text = SkipPast(text + 4, end, "-->");
+        }
+        else if(end - text >= 9 && !memcmp(text, "<![CDATA[", 9)){
+            text = SkipPast(text + 9, end, "]]>");
+        }
+        else if(end - text >= 2 && text[1] == '?'){
+            text = SkipPast(text + 2, end, "?>");
+        }
+        else if(end - text >= 2 && text[1] == '!'){
+            int brackets = 0;
+            for(text += 2; text < end && (*text != '>' || brackets); text++){
+                if(*text == '[')
+                    brackets++;
+                else if(*text == ']')
+                    brackets--;
             }
-            catch(std::exception&){
-                if(type)
-                    *type = SizeType::none;
-                *value = 0;
+            text = text < end ? text + 1 : nullptr;
+        }
+        else if(end - text >= 2 && text[1] == '/'){
+            const char* close = FindTagEnd(text, end);
+            if(!close && !final){
+                text = tag;
+                break;
             }
-            return;
+            if(!close || --state->Depth < 0)
+                return false;
+            text = close + 1;
+            if(state->InRoot && state->Depth == 1 && state->InSlide){
+                state->InSlide = false;
+                onSlide(state->SlideBegin, (size_t)(text - xml));
+            }
+            else if(state->InRoot && state->Depth == 0){
+                state->InRoot = false;
+            }
+        }
+        else{
+            const char* close = FindTagEnd(text, end);
+            if(!close && !final){
+                text = tag;
+                break;
+            }
+            if(!close)
+                return false;
+            const char* name = tag + 1;
+            const char* nameEnd = name;
+            while(nameEnd < close && !isspace((unsigned char)*nameEnd) && *nameEnd != '/')
+                nameEnd++;
+            bool selfClosing = close[-1] == '/';
+            text = close + 1;
+            if(state->Depth == 0 && !state->RootFound && NameEquals(name, nameEnd, "Presentation")){
+                state->RootFound = true;
+                state->InRoot = !selfClosing;
+                onRoot((size_t)(tag - xml), (size_t)(text - xml));
+            }
+            else if(state->InRoot && state->Depth == 1){
+                if(!state->SlidesStarted && NameEquals(name, nameEnd, "Slide"))
+                    state->SlidesStarted = true;
+                if(state->SlidesStarted && selfClosing){
+                    onSlide((size_t)(tag - xml), (size_t)(text - xml));
+                }
+                else if(state->SlidesStarted){
+                    state->InSlide = true;
+                    state->SlideBegin = (size_t)(tag - xml);
+                }
+            }
+            if(!selfClosing)
+                state->Depth++;
+        }
+        if(!text){
+            if(final)
+                return false;
+            text = tag;
+            break;
         }
     }
+    state->Position = text ? (size_t)(text - xml) : size;
+    return true;
+}
+
+static bool IndexSlides(const char* xml, size_t size, Presentation::XMLRange* rootTag,
+                        std::vector<Presentation::XMLRange>* slides){
+    SlideScanState state;
+    bool valid = ScanSlides(xml, size, true, &state,
+        [rootTag](size_t begin, size_t end){ *rootTag = { begin, end }; },
+        [slides](size_t begin, size_t end){ slides->push_back({ begin, end }); });
+    return valid && state.RootFound;
+}
+
+static QString ParseRootTitle(const char* tag, size_t length){
+    std::string rootXML(tag, length);
+    if(rootXML.size() < 2 || rootXML[rootXML.size() - 2] != '/')
+        rootXML.insert(rootXML.size() - 1, "/");
+    rapidxml::xml_document<> xml_doc;
     try{
-        *value = std::stoi(qstr.toStdString(), nullptr, 10);
+        xml_doc.parse<0>(&rootXML[0]);
     }
-    catch(std::exception&){
-        if(type)
-            *type = SizeType::none;
-        *value = 0;
+    catch(rapidxml::parse_error& e){
+        char* err_str = new char[128];
+        strcpy(err_str, "Failed to parse main.xml file inside the spres archive.\n\nError: ");
+        throw PresentationException(strcat(err_str, e.what()));
     }
-    return;
+    return ToQString(GetAttributeValue("Title", xml_doc.first_node()));
 }
 
-Presentation::Presentation(QString FilePath){
-    m_TmpDir.setAutoRemove(false);
-    this->Slides = std::vector<PresentationSlide*>();
-    this->m_spres_archive = 0;
-    struct zip_file *zf = 0;
-    struct zip_stat zs;
-    int z_err;
-    char buf[BUF_LENGTH];
-    if((this->m_spres_archive = zip_open(FilePath.toStdString().c_str(), 0, &z_err)) == NULL){
-        zip_error_to_str(buf, BUF_LENGTH, z_err, errno);
-        char* err_str = new char[128];
-        strcpy(err_str, "Failed to open spres archive.\n\nError: ");
-        throw PresentationException(strcat(err_str, buf));
+// Re-interns strings pooled elsewhere so equal strings share one copy.
+static void InternSlideStrings(StringPool* strings, PresentationSlide* slide){
+    slide->SlideBackgroundFileName = strings->intern(slide->SlideBackgroundFileName);
+    for(PresentationImage& image : slide->Images){
+        image.Alt = strings->intern(image.Alt);
+        image.FileName = strings->intern(image.FileName);
     }
-    z_err = zip_stat(this->m_spres_archive, "main.xml", ZIP_FL_NOCASE, &zs);
-    if(z_err){
-        zip_error_to_str(buf, BUF_LENGTH, z_err, errno);
-        char* err_str = new char[128];
-        strcpy(err_str, "Failed to open main.xml file inside the spres archive.\n\nError: ");
-        throw PresentationException(strcat(err_str, buf));
+    for(PresentationText& text : slide->Texts)
+        text.Text = strings->intern(text.Text);
+}
+
+// Returns the parser error, or nullptr when the slide was parsed.
+static const char* ParseSlideXML(char* xml, PresentationSlideStore* store, PresentationSlide* slide){
+    rapidxml::xml_document<> xml_doc;
+    try{
+        xml_doc.parse<0>(xml);
     }
-    zf = zip_fopen(this->m_spres_archive, "main.xml", ZIP_FL_NOCASE);
-    if(!zf){
-        throw PresentationException("Failed to open main.xml file inside the spres archive.");
+    catch(rapidxml::parse_error& e){
+        return e.what();
     }
+    ParseSlide(xml_doc.first_node(), store, slide);
+    return nullptr;
+}
 
-    char XMLstr[zs.size + 1];
-    XMLstr[zs.size] = 0;
-    int sum = 0;
-    while (sum != zs.size) {
-        uint8_t len = zip_fread(zf, buf, BUF_LENGTH);
-        if (len < 0) {
-            throw PresentationException("Failed to read main.xml file inside spres archive.");
+Presentation::Presentation(QString FilePath, PresentationLoadMode Mode, bool UseModelCache,
+                           std::shared_ptr<PresentationLoadProgress> Progress, bool MapArchive){
+    TRACE_SCOPE("Presentation::Presentation", "load");
+    if(Progress)
+        m_Progress = Progress;
+    QString error;
+    m_Archive = std::make_shared<ArchiveReader>(FilePath, 0, MapArchive);
+    bool opened;
+    {
+        TRACE_SCOPE("ArchiveReader::open", "load");
+        opened = m_Archive->open(&error);
+    }
+    if(!opened){
+        m_Archive.reset();
+        QByteArray buf = error.toUtf8();
+        char* err_str = new char[128];
+        strcpy(err_str, "Failed to open spres archive.\n\nError: ");
+        throw PresentationException(strncat(err_str, buf.constData(), 127 - strlen(err_str)));
+    }
+    m_ArchiveFile.setFileName(FilePath);
+    m_Progress->AssetsIndexed.store((qint64)m_Archive->index().size());
+    InitImageDecoder();
+    try{
+        if(UseModelCache && LoadModelCache())
+            return;
+        if(Mode == PresentationLoadMode::streaming){
+            StreamMainXML();
+            SaveModelCache();
+            return;
         }
-        for(uint8_t i = 0; i < len; i++){
-            XMLstr[sum + i] = buf[i];
+        ReadMainXML();
+        CheckCancelled();
+        if(Mode == PresentationLoadMode::lazy){
+            IndexMainXML();
+            CheckCancelled();
+        }
+        else{
+            ParseMainXML();
+            CheckCancelled();
+            SaveModelCache();
         }
-        sum += len;
     }
-    zip_fclose(zf);
+    catch(PresentationException&){
+        Close();
+        throw;
+    }
+}
 
-#pragma region PARSING
+const ArchiveEntry& Presentation::FindMainXML(){
+    const ArchiveEntry* entry = m_Archive->find("main.xml");
+    if(!entry){
+        char* err_str = new char[128];
+        strcpy(err_str, "Failed to open main.xml file inside the spres archive.\n\nError: ");
+        throw PresentationException(strcat(err_str, "No such file"));
+    }
+    return *entry;
+}
+
+void Presentation::CheckCancelled(){
+    if(m_Progress->Cancelled.load())
+        throw PresentationException("Loading the presentation was cancelled.");
+}
 
+void Presentation::ParseMainXML(){
+    TRACE_SCOPE("Presentation::ParseMainXML", "load");
     rapidxml::xml_document<> xml_doc;
     rapidxml::xml_node<> *root_node = NULL;
     rapidxml::xml_node<> *slide_node = NULL;
-    rapidxml::xml_node<> *image_node = NULL;
-    rapidxml::xml_node<> *text_node = NULL;
-    rapidxml::xml_node<> *temp_node = NULL;
     
     try{
-        xml_doc.parse<0>(XMLstr);
+        xml_doc.parse<0>(m_XMLData);
     }
     catch(rapidxml::parse_error& e){
         char* err_str = new char[128];
@@ -231,194 +562,399 @@ Presentation::Presentation(QString FilePath){
         throw PresentationException("Failed to find XML root element (Presentation) in main.xml file inside the spres archive.");
     }
 
-    this->Title = GetAttributeValue("Title", root_node);
+    this->Title = ToQString(GetAttributeValue("Title", root_node));
+    std::vector<rapidxml::xml_node<>*> slide_nodes;
     slide_node = root_node->first_node("Slide", 0UL, false);
-    int slide_count = 0;
     while (slide_node)
     {
-        PresentationSlide* slide = new PresentationSlide;
-        slide->SlideTitle = GetAttributeValue("Title", slide_node);
-        temp_node = slide_node->first_node("SlideBackground");
-        slide->SlideBackgroundFileName = GetAttributeValue("Filename", temp_node);
-        if(slide->SlideBackgroundFileName.isEmpty()){
-            if(temp_node){
-                temp_node = temp_node->first_node("Color", 0UL, false);
-                union {
-                    uint32_t RGBA;
-                    uint8_t bytes[4];
-                } RGBA;
-                RGBA.bytes[0] = (uint8_t)GetIntValue("r", temp_node);
-                RGBA.bytes[1] = (uint8_t)GetIntValue("g", temp_node);
-                RGBA.bytes[2] = (uint8_t)GetIntValue("b", temp_node);
-                RGBA.bytes[3] = 255;
-                slide->SlideBackgroundColor = RGBA.RGBA;
-                slide->hasBackgroundColor = true;
-            }
-        }
+        slide_nodes.push_back(slide_node);
+        slide_node = slide_node->next_sibling();
+    }
+    m_Slides.resize(slide_nodes.size());
+    m_SlideLoaded.assign(m_Slides.size(), true);
+    m_Progress->SlideCount.store((qint64)slide_nodes.size());
 
-        unsigned int imageCount = 0;
-        image_node = slide_node->first_node("Image", 0UL, false);
-        while(image_node){
-            PresentationImage image;
-            image.Alt = GetValue("Alt", image_node);
-            image.FileName = GetAttributeValue("Filename", image_node);
-            int x, y;
-            SizeType x_type, y_type;
-            temp_node = image_node->first_node("size", 0UL, false);
-            GetIntValue("width", temp_node, &x, &x_type);
-            GetIntValue("height", temp_node, &y, &y_type);
-            image.Size_type[0] = x_type;
-            image.Size_type[1] = y_type;
-            image.Size = QSize(x, y);
-            temp_node = image_node->first_node("position", 0UL, false);
-            GetIntValue("x", temp_node, &x, &x_type);
-            GetIntValue("y", temp_node, &y, &y_type);
-            image.Position_type[0] = x_type;
-            image.Position_type[1] = y_type;
-            image.Position = QPoint(x, y);
-            slide->Images.push_back(image);
-            imageCount++;
-            image_node = image_node->next_sibling(image_node->name(), image_node->name_size(), false);
+    // The DOM is only read from here on, so slides are materialized in chunks
+    // on a pool. Each task writes its own slots, which keeps the order fixed.
+    const size_t threads = (size_t)qMax(1, QThread::idealThreadCount());
+    const size_t chunkSize = qMax<size_t>(16, slide_nodes.size() / (threads * 8));
+    if(threads == 1 || slide_nodes.size() <= chunkSize){
+        for(size_t i = 0; i < slide_nodes.size() && !m_Progress->Cancelled.load(); i++){
+            ParseSlide(slide_nodes[i], &m_SlideStore, &m_Slides[i]);
+            m_Progress->SlidesParsed.fetch_add(1);
         }
-
-        unsigned int textCount = 0;
-        text_node = slide_node->first_node("Text", 0UL, false);
-        while(text_node){
-            PresentationText text;
-            text.Text = GetValue("String", text_node);
-            text.Text.replace("\\n", "\n");
-            if(text.Text.isEmpty()){
-                text.Text = GetAttributeValue("String", text_node);
-                text.Text.replace("\\n", "\n");
+        m_Progress->Finished.store(true);
+        return;
+    }
+    // Every task also gets its own arenas and string pool, so workers never
+    // contend on the presentation's locks; they are folded in after the join.
+    QThreadPool pool;
+    pool.setMaxThreadCount((int)threads);
+    std::vector<std::unique_ptr<PresentationSlideStore>> stores;
+    for(size_t first = 0; first < slide_nodes.size(); first += chunkSize){
+        size_t last = qMin(first + chunkSize, slide_nodes.size());
+        stores.emplace_back(new PresentationSlideStore);
+        PresentationSlideStore* store = stores.back().get();
+        pool.start([this, &slide_nodes, store, first, last](){
+            for(size_t i = first; i < last && !m_Progress->Cancelled.load(); i++){
+                ParseSlide(slide_nodes[i], store, &m_Slides[i]);
+                m_Progress->SlidesParsed.fetch_add(1);
             }
-            text.isBold = false;
-            text.isItalic = false;
-            text.isStrikedOut = false;
-            text.isUnderlined = false;
+        });
+    }
+    pool.waitForDone();
+    for(std::unique_ptr<PresentationSlideStore>& store : stores){
+        m_SlideStore.Texts.adopt(store->Texts);
+        m_SlideStore.Images.adopt(store->Images);
+    }
+    for(PresentationSlide& slide : m_Slides)
+        InternSlideStrings(&m_SlideStore.Strings, &slide);
+    m_Progress->Finished.store(true);
+}
 
-            text.Alignment = GetAlignmentFlags(text_node->first_node("Alignment", 0UL, false));
+void Presentation::IndexMainXML(){
+    TRACE_SCOPE("Presentation::IndexMainXML", "load");
+    XMLRange rootTag = { 0, 0 };
+    if(!IndexSlides(m_XMLData, (size_t)m_XMLSize, &rootTag, &m_SlideRanges)){
+        throw PresentationException("Failed to find XML root element (Presentation) in main.xml file inside the spres archive.");
+    }
+    this->Title = ParseRootTitle(m_XMLData + rootTag.Begin, rootTag.End - rootTag.Begin);
+    m_Slides.resize(m_SlideRanges.size());
+    m_SlideLoaded.assign(m_SlideRanges.size(), false);
+    m_Progress->SlideCount.store((qint64)m_Slides.size());
+    if(m_Slides.empty()){
+        m_Progress->Finished.store(true);
+        return;
+    }
+    // Later slides can only be reported, but a broken first slide fails the
+    // load the same way it would in eager or streaming mode.
+    GetSlide(0);
+    if(const char* error = m_SlideParseError.load()){
+        char* err_str = new char[128];
+        strcpy(err_str, "Failed to parse main.xml file inside the spres archive.\n\nError: ");
+        throw PresentationException(strncat(err_str, error, 127 - strlen(err_str)));
+    }
+    m_SlideLoader.reset(QThread::create([this](){
+        for(size_t i = 1; i < m_Slides.size() && !m_StopLoading.load(); i++)
+            GetSlide(i);
+        // An empty stand-in for a broken slide must not outlive this load.
+        if(!m_StopLoading.load() && !m_SlideParseError.load())
+            SaveModelCache();
+        m_Progress->Finished.store(true);
+    }));
+    m_SlideLoader->setObjectName("slide loader");
+    m_SlideLoader->start(QThread::LowPriority);
+}
 
-            temp_node = text_node->first_node("Font", 0UL, false);
-            GetIntValue("Size", temp_node, &text.fontSize, &text.fontSizeType);
-            if(temp_node)
-                temp_node = temp_node->first_node("Color", 0UL, false);
-            union {
-                uint32_t RGBA;
-                uint8_t bytes[4];
-            } RGBA;
-            RGBA.bytes[0] = (uint8_t)GetIntValue("r", temp_node);
-            RGBA.bytes[1] = (uint8_t)GetIntValue("g", temp_node);
-            RGBA.bytes[2] = (uint8_t)GetIntValue("b", temp_node);
-            RGBA.bytes[3] = 255;
-            text.FontColor = RGBA.RGBA;
-            int x, y;
-            SizeType x_type, y_type;
-            temp_node = text_node->first_node("size", 0UL, false);
-            GetIntValue("width", temp_node, &x, &x_type);
-            GetIntValue("height", temp_node, &y, &y_type);
-            text.Size_type[0] = x_type;
-            text.Size_type[1] = y_type;
-            text.Size = QSize(x, y);
-            temp_node = text_node->first_node("position", 0UL, false);
-            GetIntValue("x", temp_node, &x, &x_type);
-            GetIntValue("y", temp_node, &y, &y_type);
-            text.Position_type[0] = x_type;
-            text.Position_type[1] = y_type;
-            text.Position = QPoint(x, y);
-
-            slide->Texts.push_back(text);
-            textCount++;
-            text_node = text_node->next_sibling(text_node->name(), text_node->name_size(), false);
+void Presentation::ParseSlideRange(const XMLRange& Range, PresentationSlide* Slide){
+    std::vector<char> xml(m_XMLData + Range.Begin, m_XMLData + Range.End);
+    xml.push_back(0);
+    const char* error = ParseSlideXML(xml.data(), &m_SlideStore, Slide);
+    if(error){
+        printf("[WARNING] Failed to parse slide in main.xml file. Error: %s.\n", error);
+        m_SlideParseError.store(error);
+    }
+}
+
+void Presentation::StreamMainXML(){
+    TRACE_SCOPE("Presentation::StreamMainXML", "load");
+    const ArchiveEntry& entry = FindMainXML();
+    std::unique_ptr<ArchiveReader::Stream> zf = m_Archive->openStream(entry);
+    if(!zf){
+        throw PresentationException("Failed to open main.xml file inside the spres archive.");
+    }
+
+    // Only the unscanned tail and the slide being read stay in the buffer, so
+    // memory is bounded by the largest slide rather than by the deck.
+    const size_t chunkSize = 256 * 1024;
+    m_Progress->BytesTotal.store((qint64)entry.Size);
+    std::vector<char> buffer;
+    size_t used = 0;
+    SlideScanState state;
+    bool final = false;
+    while(!final){
+        CheckCancelled();
+        buffer.resize(used + chunkSize + 1);
+        zip_int64_t len = zf->read(buffer.data() + used, chunkSize);
+        if(len < 0){
+            throw PresentationException("Failed to read main.xml file inside spres archive.");
         }
+        used += (size_t)len;
+        final = len == 0;
+        m_Progress->BytesRead.fetch_add(len);
+        bool valid = ScanSlides(buffer.data(), used, final, &state,
+            [this, &buffer](size_t begin, size_t end){
+                this->Title = ParseRootTitle(buffer.data() + begin, end - begin);
+            },
+            [this, &buffer](size_t begin, size_t end){
+                char next = buffer[end];
+                buffer[end] = 0;
+                m_Slides.emplace_back();
+                const char* error = ParseSlideXML(buffer.data() + begin, &m_SlideStore, &m_Slides.back());
+                if(error){
+                    char* err_str = new char[128];
+                    strcpy(err_str, "Failed to parse main.xml file inside the spres archive.\n\nError: ");
+                    throw PresentationException(strncat(err_str, error, 127 - strlen(err_str)));
+                }
+                buffer[end] = next;
+                m_Progress->SlideCount.store((qint64)m_Slides.size());
+                m_Progress->SlidesParsed.fetch_add(1);
+            });
+        if(!valid){
+            throw PresentationException("Failed to parse main.xml file inside the spres archive.");
+        }
+        size_t keep = state.InSlide ? state.SlideBegin : state.Position;
+        memmove(buffer.data(), buffer.data() + keep, used - keep);
+        used -= keep;
+        state.Position -= keep;
+        if(state.InSlide)
+            state.SlideBegin -= keep;
+    }
+    zf.reset();
+    if(!state.RootFound){
+        throw PresentationException("Failed to find XML root element (Presentation) in main.xml file inside the spres archive.");
+    }
+    m_XMLSize = (qint64)entry.Size;
+    m_SlideLoaded.assign(m_Slides.size(), true);
+    m_Progress->Finished.store(true);
+}
 
-        this->Slides.push_back(slide);
-        image_node = NULL;
-        text_node = NULL;
-        slide_count++;
-        slide_node = slide_node->next_sibling();
+PresentationSlide* Presentation::GetSlide(size_t Index){
+    QMutexLocker locker(&m_SlidesMutex);
+    PresentationSlide* slide = &m_Slides.at(Index);
+    if(!m_SlideLoaded[Index]){
+        ParseSlideRange(m_SlideRanges[Index], slide);
+        m_SlideLoaded[Index] = true;
+        m_Progress->SlidesParsed.fetch_add(1);
     }
+    return slide;
+}
 #pragma endregion PARSING
+
+
+bool Presentation::LoadModelCache(){
+    TRACE_SCOPE("Presentation::LoadModelCache", "load");
+    const ArchiveEntry* entry = m_Archive->find("main.xml");
+    if(!entry || !(entry->Valid & ZIP_STAT_CRC) || !(entry->Valid & ZIP_STAT_SIZE))
+        return false;
+    m_XMLCrc = entry->Crc;
+    m_ModelCachePath = SlideModelCache::cachePath(entry->Crc, entry->Size);
+    SlideModelCache cache;
+    if(m_ModelCachePath.isEmpty() || !cache.open(m_ModelCachePath, entry->Crc, entry->Size))
+        return false;
+    cache.load(&m_SlideStore, &m_Slides, &this->Title);
+    m_SlideLoaded.assign(m_Slides.size(), true);
+    m_Progress->SlideCount.store((qint64)m_Slides.size());
+    m_Progress->SlidesParsed.store((qint64)m_Slides.size());
+    m_Progress->Finished.store(true);
+    return true;
+}
+
+void Presentation::SaveModelCache(){
+    if(m_ModelCachePath.isEmpty())
+        return;
+    TRACE_SCOPE("Presentation::SaveModelCache", "load");
+    if(!SlideModelCache::save(m_ModelCachePath, m_XMLCrc, (quint64)m_XMLSize, this->Title, m_Slides))
+        printf("[WARNING] Failed to write slide cache %s.\n", m_ModelCachePath.toStdString().c_str());
+}
+
+bool Presentation::MapStoredMainXML(const ArchiveEntry& Entry){
+    // Offsets are only known when the archive is mapped; otherwise main.xml
+    // is always read into memory.
+    if(Entry.CompressionMethod != ZIP_CM_STORE || Entry.EncryptionMethod != ZIP_EM_NONE ||
+        Entry.CompressedSize != Entry.Size || Entry.LocalHeaderOffset < 0)
+        return false;
+    if(!m_ArchiveFile.isOpen() && !m_ArchiveFile.open(QIODevice::ReadOnly))
+        return false;
+    qint64 archiveSize = m_ArchiveFile.size();
+    qint64 dataOffset = m_Archive->dataOffset(Entry);
+    if(dataOffset < 0 || dataOffset + (qint64)Entry.Size >= archiveSize)
+        return false;
+    // The byte following the entry always belongs to the archive, so a private
+    // mapping of size + 1 lets RapidXML see a terminated string without a copy.
+    m_XMLMap = m_ArchiveFile.map(dataOffset, (qint64)Entry.Size + 1, QFileDevice::MapPrivateOption);
+    if(!m_XMLMap)
+        return false;
+    m_XMLMap[Entry.Size] = 0;
+    m_XMLData = (char*)m_XMLMap;
+    m_XMLSize = (qint64)Entry.Size;
+    return true;
+}
+
+void Presentation::ReadMainXML(){
+    TRACE_SCOPE("Presentation::ReadMainXML", "load");
+    const ArchiveEntry& entry = FindMainXML();
+    zip_uint64_t size = entry.Size;
+    if(!(entry.Valid & ZIP_STAT_SIZE) ||
+        size >= (zip_uint64_t)std::numeric_limits<qint64>::max() ||
+        size >= (zip_uint64_t)std::numeric_limits<size_t>::max()){
+        throw PresentationException("Invalid size of main.xml file inside the spres archive.");
+    }
+    m_Progress->BytesTotal.store((qint64)size);
+
+    if(MapStoredMainXML(entry)){
+        m_Progress->BytesRead.store((qint64)size);
+        return;
+    }
+
+    std::unique_ptr<ArchiveReader::Stream> zf = m_Archive->openStream(entry);
+    if(!zf){
+        throw PresentationException("Failed to open main.xml file inside the spres archive.");
+    }
+    try{
+        m_XMLBuffer.reset(new char[size + 1]);
+    }
+    catch(std::bad_alloc&){
+        throw PresentationException("main.xml file inside the spres archive is too large to load.");
+    }
+    zip_uint64_t sum = 0;
+    const zip_uint64_t chunkSize = 1024 * 1024;
+    while(sum != size){
+        if(m_Progress->Cancelled.load()){
+            m_XMLBuffer.reset();
+            CheckCancelled();
+        }
+        zip_int64_t len = zf->read(m_XMLBuffer.get() + sum, qMin(chunkSize, size - sum));
+        if(len <= 0){
+            m_XMLBuffer.reset();
+            throw PresentationException("Failed to read main.xml file inside spres archive.");
+        }
+        sum += (zip_uint64_t)len;
+        m_Progress->BytesRead.store((qint64)sum);
+    }
+    m_XMLBuffer[size] = 0;
+    m_XMLData = m_XMLBuffer.get();
+    m_XMLSize = (qint64)size;
+}
+
+void Presentation::CopySlides(Presentation& Other){
+    m_Slides.resize(Other.SlideCount());
+    m_SlideLoaded.assign(Other.SlideCount(), true);
+    for(size_t i = 0; i < Other.SlideCount(); i++){
+        const PresentationSlide* slide = Other.GetSlide(i);
+        std::vector<PresentationImage> images(slide->Images.begin(), slide->Images.end());
+        std::vector<PresentationText> texts(slide->Texts.begin(), slide->Texts.end());
+        m_Slides[i].SlideBackgroundFileName = slide->SlideBackgroundFileName;
+        m_Slides[i].SlideTitle = slide->SlideTitle;
+        m_Slides[i].SlideBackgroundColor = slide->SlideBackgroundColor;
+        m_Slides[i].hasBackgroundColor = slide->hasBackgroundColor;
+        m_Slides[i].Images = m_SlideStore.Images.allocate(images);
+        m_Slides[i].Texts = m_SlideStore.Texts.allocate(texts);
+    }
 }
 
 Presentation::Presentation(Presentation& other){
-    this->m_spres_archive = other.m_spres_archive;
-    this->Slides = other.Slides;
+    this->m_Archive = other.m_Archive;
+    CopySlides(other);
     this->Title = other.Title;
+    InitImageDecoder();
 }
 
 Presentation::Presentation(Presentation&& other){
-    this->m_spres_archive = other.m_spres_archive;
-    this->Slides = other.Slides;
+    this->m_Archive = other.m_Archive;
+    CopySlides(other);
     this->Title = other.Title;
+    if(other.m_XMLMap){
+        m_XMLBuffer.reset(new char[other.m_XMLSize + 1]);
+        memcpy(m_XMLBuffer.get(), other.m_XMLData, other.m_XMLSize + 1);
+    }
+    else{
+        m_XMLBuffer = std::move(other.m_XMLBuffer);
+    }
+    m_XMLData = m_XMLBuffer.get();
+    m_XMLSize = other.m_XMLSize;
+    InitImageDecoder();
+}
+
+void Presentation::InitImageDecoder(){
+    m_ImageDecoder.reset(new ImageDecoder([this](const QString& name){ return ReadImageEntry(name); }, &m_ImageCache));
 }
 
 Presentation::~Presentation(){
-    zip_close(m_spres_archive);
-    m_TmpDir.remove();
+    Close();
+}
+
+void Presentation::Close(){
+    m_StopLoading.store(true);
+    if(m_SlideLoader)
+        m_SlideLoader->wait();
+    m_ImageDecoder.reset();
+    if(m_XMLMap)
+        m_ArchiveFile.unmap(m_XMLMap);
+    m_XMLMap = nullptr;
+    m_Archive.reset();
+    m_Progress->Finished.store(true);
+}
+
+void Presentation::SetImageCacheBudget(qint64 Bytes){
+    m_ImageCache.setMaxBytes(Bytes);
+}
+
+const ArchiveIndex& Presentation::GetArchiveIndex() const{
+    static const ArchiveIndex empty;
+    return m_Archive ? m_Archive->index() : empty;
+}
+
+ImageCache* Presentation::GetImageCache(){
+    return &m_ImageCache;
+}
+
+const ImageDecoderCounters& Presentation::ImageCounters() const{
+    return m_ImageDecoder->counters();
 }
 
 QPixmap Presentation::GetImage(QString ImageFileName){
-    if(ImageFileName.contains("..") || ImageFileName.contains("/") || ImageFileName.contains("\\"))
-        throw PresentationException("Detected Path Traversal. File access denied.");
-    if(m_TmpDir.isValid()){
-        QString filePath = m_TmpDir.path();
-        if(!filePath.endsWith("/"))
-            filePath += QString("/");
-        filePath += ImageFileName;
-        if(DoesFileExist(filePath.toStdString().c_str())){
-            return QPixmap(filePath);
-        }
-    }
-    else{
-        char* err_str = new char[128];
-        strcpy(err_str, "Failed to load an image. Could not create temporary directory.\n\nError: ");
-        throw PresentationException(strcat(err_str, m_TmpDir.errorString().toStdString().c_str()));
-    }
+    TRACE_SCOPE("Presentation::GetImage", "image");
+    return QPixmap::fromImage(m_ImageDecoder->image(ImageFileName));
+}
+
+QPixmap Presentation::GetImage(QString ImageFileName, QSize Size){
+    TRACE_SCOPE("Presentation::GetImage", "image");
+    return QPixmap::fromImage(m_ImageDecoder->image(ImageFileName, Size));
+}
+
+QImage Presentation::DecodeImage(const QString& ImageFileName, const QSize& Size){
+    TRACE_SCOPE("Presentation::DecodeImage", "image");
+    return m_ImageDecoder->image(ImageFileName, Size);
+}
+
+void Presentation::RequestImage(const QString& ImageFileName, const QSize& Size, const ImageRequestToken& Token,
+                                QObject* Context, ImageCallback Callback){
+    m_ImageDecoder->request(ImageFileName, Size, Token, Context, Callback);
+}
+
+void Presentation::CancelImageRequests(){
+    m_ImageDecoder->cancelAll();
+}
 
-    if(!m_spres_archive)
+void Presentation::DrainImageRequests(){
+    m_ImageDecoder->drain();
+}
+
+QByteArray Presentation::ReadEntry(const QString& EntryName){
+    TRACE_SCOPE("Presentation::ReadEntry", "image");
+    std::shared_ptr<ArchiveReader> archive = m_Archive;
+    if(!archive)
         throw PresentationException("Could not open spres archive to read image data.");
-    QString filePath = m_TmpDir.path();
-    if(!filePath.endsWith("/"))
-        filePath += QString("/");
-    filePath += ImageFileName;
-    char err_buf[BUF_LENGTH];
-    int z_err = 0; 
-    struct zip_file *zf;
-    struct zip_stat zs;
-
-    z_err = zip_stat(m_spres_archive, ImageFileName.toStdString().c_str(), ZIP_FL_NOCASE, &zs);
-    if(z_err){
-        zip_error_to_str(err_buf, BUF_LENGTH, z_err, errno);
-        char* err_str = new char[128];
-        strcpy(err_str, "Failed to open Image: ");
-        strcat(err_str, ImageFileName.toStdString().c_str());
-        strcat(err_str, ". Error: ");
-        strcat(err_str, err_buf);
-        throw PresentationException(err_str);
-    }
-    zf = zip_fopen(m_spres_archive, ImageFileName.toStdString().c_str(), ZIP_FL_NOCASE);
-    if(!zf){
+    QByteArray name = EntryName.toUtf8();
+    const ArchiveEntry* entry = archive->find(EntryName);
+    if(!entry){
         char* err_str = new char[128];
         strcpy(err_str, "Failed to open Image: ");
-        throw PresentationException(strcat(err_str, ImageFileName.toStdString().c_str()));
-    }
-    QFile file(filePath);
-    if(!file.open(QIODevice::OpenModeFlag::Append))
-    {
-        printf("Failed to open file. %s\n", filePath.toStdString().c_str());
+        strncat(err_str, name.constData(), 127 - strlen(err_str));
+        strncat(err_str, ". Error: ", 127 - strlen(err_str));
+        throw PresentationException(strncat(err_str, "No such file", 127 - strlen(err_str)));
     }
-    else{
-        int sum = 0, len = 0;
-        char buf[BUF_LENGTH];
-        while (sum != zs.size) {
-            len = zip_fread(zf, buf, BUF_LENGTH);
-            if (len < 0) {
-                throw PresentationException("Failed to read image data.");
-            }
-            file.write(buf, len);
-            sum += len;
-        }
-        file.close();
-    }
-    return QPixmap(filePath);
+    if(!(entry->Valid & ZIP_STAT_SIZE) || entry->Size > (zip_uint64_t)std::numeric_limits<int>::max())
+        throw PresentationException("Invalid image data size.");
+    QByteArray data;
+    if(!archive->read(*entry, &data))
+        throw PresentationException("Failed to read image data.");
+    return data;
+}
+
+QByteArray Presentation::ReadImageEntry(const QString& ImageFileName){
+    if(ImageFileName.contains("..") || ImageFileName.contains("/") || ImageFileName.contains("\\"))
+        throw PresentationException("Detected Path Traversal. File access denied.");
+    return ReadEntry(ImageFileName);
 }
@@ -0,0 +1,80 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <PresentationLoader.hpp>
+
+PresentationLoader::PresentationLoader(const QString& filePath, PresentationLoadMode mode, bool useModelCache, QObject* parent)
+    : QObject(parent), m_filePath(filePath), m_mode(mode), m_useModelCache(useModelCache),
+      m_progress(std::make_shared<PresentationLoadProgress>()){
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(100);
+    connect(m_progressTimer, &QTimer::timeout, this, &PresentationLoader::reportProgress);
+}
+
+PresentationLoader::~PresentationLoader(){
+    m_progress->Cancelled.store(true);
+    if(m_thread)
+        m_thread->wait();
+    delete m_presentation;
+}
+
+void PresentationLoader::start(){
+    if(m_thread)
+        return;
+    m_thread.reset(QThread::create([this](){
+        try{
+            m_presentation = new Presentation(m_filePath, m_mode, m_useModelCache, m_progress, m_mapArchive);
+        }
+        catch(PresentationException& e){
+            m_error = QString(e.what());
+        }
+        QMetaObject::invokeMethod(this, &PresentationLoader::finishLoading, Qt::QueuedConnection);
+    }));
+    m_thread->start();
+    m_progressTimer->start();
+}
+
+void PresentationLoader::cancel(){
+    if(!m_delivered)
+        m_progress->Cancelled.store(true);
+}
+
+void PresentationLoader::finishLoading(){
+    m_thread->wait();
+    m_delivered = true;
+    if(m_presentation){
+        Presentation* presentation = m_presentation;
+        m_presentation = nullptr;
+        emit loaded(presentation);
+        reportProgress();
+        return;
+    }
+    m_progressTimer->stop();
+    if(m_progress->Cancelled.load())
+        emit cancelled();
+    else
+        emit failed(m_error);
+    emit finished();
+}
+
+void PresentationLoader::reportProgress(){
+    emit progress(m_progress->BytesRead.load(), m_progress->BytesTotal.load(), m_progress->SlidesParsed.load(),
+                  m_progress->SlideCount.load(), m_progress->AssetsIndexed.load());
+    if(m_delivered && m_progress->Finished.load() && m_progressTimer->isActive()){
+        m_progressTimer->stop();
+        emit finished();
+    }
+}
@@ -18,184 +18,226 @@
 #include <PresentationSlideView.hpp>
 #include <stdio.h>
 #include <Application.hpp>
+#include <Trace.hpp>
 
 PresentationSlideView::PresentationSlideView(QWidget *parent) : QWidget(parent) {
-    int w = 0, h = 0, y = 0, ph = 0;
-    if(parent){
-        w = parent->width();
-        ph = parent->height();
-    }
-    h = ( w / 16) * 9;
-    y = (ph - h) / 2;
-    this->setGeometry(0, y, w, h);
-    this->setPalette(QPalette(QColor::fromRgb(255, 255, 255, 255)));
-    this->setAutoFillBackground(true);
+    this->setGeometry(slideGeometry(parent ? parent->size() : QSize()));
+    this->setAttribute(Qt::WA_OpaquePaintEvent, true);
+    m_transitionTimer = new QTimer(this);
+    m_transitionTimer->setSingleShot(true);
+    m_transitionTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_transitionTimer, &QTimer::timeout, this, &PresentationSlideView::advanceTransition);
 }
 
+QRect PresentationSlideView::slideGeometry(const QSize& parentSize){
+    int w = parentSize.width(), ph = parentSize.height();
+    int h = ( w / 16) * 9;
+    int y = (ph - h) / 2;
+    return QRect(0, y, w, h);
+}
 
 void PresentationSlideView::clearSlideView(){
-    this->setAutoFillBackground(true);
-    this->setPalette(QPalette(QColor::fromRgb(255, 255, 255, 255)));
-    if(m_backgroundImage)
-        delete m_backgroundImage;
-    m_textWidgets.clear();
-    m_imagesWidgets.clear();
-    if(m_parentWidget)
-        delete m_parentWidget;
-
+    stopTransition();
+    m_reloadPending = false;
+    m_reloadRegion = QRegion();
+    m_imageRequests.cancel();
+    m_imageRequests = ImageRequestToken();
+    m_renderer.clear();
+    m_adopted.reset();
+    m_frame = QImage();
+    m_presentation = nullptr;
+    m_slide = nullptr;
+    update();
 }
 
-static int getXPosition(const float percentXPosition, const QSize& screenSize, const QSize& widgetSize){
-    return (int)(percentXPosition * (float)screenSize.width()) - (int)((float)widgetSize.width() / 2.0f);
+void PresentationSlideView::setSlide(Presentation* presentation, unsigned int index){
+    TRACE_SCOPE("PresentationSlideView::setSlide", "view");
+    clearSlideView();
+    m_index = index;
+    if(presentation && presentation->GetSlide(index)){
+        m_presentation = presentation;
+        m_slide = m_presentation->GetSlide(index);
+        buildDisplayList();
+    }
 }
 
-static int getYPosition(const float percentYPosition, const QSize& screenSize, const QSize& widgetSize){
-    return (int)((float)-(percentYPosition - 1) * (float)screenSize.height()) - (int)((float)widgetSize.height() / 2.0f);
+void PresentationSlideView::setFrame(Presentation* presentation, unsigned int index, const QImage& frame,
+                                     bool animate, bool reverse){
+    TRACE_SCOPE("PresentationSlideView::setFrame", "view");
+    QImage previous = m_transition.isRunning() ? m_transition.frame() : m_frame;
+    clearSlideView();
+    m_index = index;
+    m_presentation = presentation;
+    m_slide = presentation ? presentation->GetSlide(index) : nullptr;
+    m_frame = frame;
+    if(animate && m_transition.start(previous, frame, reverse))
+        m_transitionTimer->start(m_transition.interval());
 }
 
-void PresentationSlideView::setSlide(Presentation* presentation, unsigned int index){
+// Takes over a render started for this slide elsewhere (a prefetch), so the
+// images it already requested are not read and decoded a second time.
+void PresentationSlideView::adoptSlide(Presentation* presentation, unsigned int index,
+                                       std::unique_ptr<SlideRenderer> renderer, const ImageRequestToken& token){
+    TRACE_SCOPE("PresentationSlideView::adoptSlide", "view");
     clearSlideView();
-    m_presentation = nullptr;
-    m_slide = nullptr;
-    if(presentation){
-        m_presentation = presentation;
-        if(m_presentation->Slides.at(index)){
-            m_parentWidget = new QWidget(this);
-            m_parentWidget->setFixedSize(this->size());
-            m_slide = m_presentation->Slides.at(index);
-            if(!m_slide->SlideBackgroundFileName.isEmpty()){
-                m_backgroundImage = new QLabel(m_parentWidget);
-                m_backgroundImage->setFixedSize(this->size());
-                m_backgroundImage->setScaledContents(true);
-                try
-                {
-                    QPixmap pixmap = m_presentation->GetImage(m_slide->SlideBackgroundFileName);
-                    
-                    m_backgroundImage->setPixmap(pixmap);
-                    this->setAutoFillBackground(false);
-                }
-                catch(const PresentationException& e)
-                {
-                    printf("[WARNING] Failed to display image: %s. Error: %s.\n", m_slide->SlideBackgroundFileName.toStdString().c_str(), e.what());
-                }
-            }
-            else if(m_slide->hasBackgroundColor){
-                this->setPalette(QPalette(QColor(m_slide->SlideBackgroundColor)));
-
-            }
-            for(unsigned int i = 0; i < m_slide->Images.size(); i++){
-                QLabel* image = new QLabel(m_parentWidget);
-                try
-                {
-                    QPixmap pixmap = m_presentation->GetImage(m_slide->Images.at(i).FileName);
-                    image->setPixmap(pixmap);
-                }
-                catch(const PresentationException& e)
-                {
-                    printf("[WARNING] Failed to display image: %s. Error: %s.\n", m_slide->Images.at(i).FileName.toStdString().c_str(), e.what());
-                    image->setText(m_slide->Images.at(i).Alt);
-                    image->setAlignment(Qt::AlignCenter);
-                }
-                image->setScaledContents(true);
-
-                if(m_slide->Images.at(i).Size_type[0] == SizeType::pixels){
-                    image->setFixedWidth(m_slide->Images.at(i).Size.width());
-                }
-                else{
-                    image->setFixedWidth(m_slide->Images.at(i).Size.width() / 100.0f * m_parentWidget->width());
-                }
-                if(m_slide->Images.at(i).Size_type[1] == SizeType::pixels){
-                    image->setFixedHeight(m_slide->Images.at(i).Size.height());
-                }
-                else{
-                    image->setFixedHeight(m_slide->Images.at(i).Size.height() / 100.0f * m_parentWidget->height());
-                }
-                if(m_slide->Images.at(i).Position_type[0] == SizeType::pixels){
-                    image->move(m_slide->Images.at(i).Position.x(), 0);
-                }
-                else{
-                    image->move(
-                            getXPosition((float)m_slide->Images.at(i).Position.x() / 100.0f,
-                            m_parentWidget->size(), image->size()), 0);
-                }
-                if(m_slide->Images.at(i).Position_type[1] == SizeType::pixels){
-                    image->move(image->x(), m_slide->Images.at(i).Position.y());
-                }
-                else{
-                    image->move(image->x(),
-                            getYPosition((float)m_slide->Images.at(i).Position.y() / 100.0f,
-                            m_parentWidget->size(), image->size()));
-                }
-            }
-            for(unsigned int i = 0; i < m_slide->Texts.size(); i++){
-                QLabel *text = new QLabel(m_parentWidget);
-                text->setText(m_slide->Texts.at(i).Text);
-                text->setTextFormat(Qt::TextFormat::PlainText);
-                QFont font = QFont();
-                font.setBold(m_slide->Texts.at(i).isBold);
-                font.setItalic(m_slide->Texts.at(i).isItalic);
-                font.setStrikeOut(m_slide->Texts.at(i).isStrikedOut);
-                font.setUnderline(m_slide->Texts.at(i).isUnderlined);
-                switch (m_slide->Texts.at(i).fontSizeType)
-                {
-                    case SizeType::points:
-                        font.setPixelSize((int)((float)m_parentWidget->height() / 400.0f * (float)m_slide->Texts.at(i).fontSize));
-                        break;
-                    case SizeType::pixels:
-                        font.setPixelSize(m_slide->Texts.at(i).fontSize);
-                        break;
-                    default:
-                        if(m_slide->Texts.at(i).fontSize < 1)
-                            m_slide->Texts.at(i).fontSize = 1;
-                        font.setPixelSize((int)((float)m_parentWidget->height() / 400.0f * (float)m_slide->Texts.at(i).fontSize));
-                        break;
-                }
-                text->setFont(font);
-                QPalette palette = QPalette();
-                palette.setColor(text->foregroundRole(), QColor::fromRgba(m_slide->Texts.at(i).FontColor));
-                text->setPalette(palette);
-                if(m_slide->Texts.at(i).Size_type[0] == SizeType::pixels){
-                    text->setFixedWidth(m_slide->Texts.at(i).Size.width());
-                }
-                else{
-                    text->setFixedWidth(m_slide->Texts.at(i).Size.width() / 100.0f * m_parentWidget->width());
-                }
-                if(m_slide->Texts.at(i).Size_type[1] == SizeType::pixels){
-                    text->setFixedHeight(m_slide->Texts.at(i).Size.height());
-                }
-                else{
-                    text->setFixedHeight(m_slide->Texts.at(i).Size.height() / 100.0f * m_parentWidget->height());
-                }
-                if(m_slide->Texts.at(i).Position_type[0] == SizeType::pixels){
-                    text->move(m_slide->Texts.at(i).Position.x(), 0);
-                }
-                else{
-                    text->move(
-                            getXPosition((float)m_slide->Texts.at(i).Position.x() / 100.0f,
-                            m_parentWidget->size(), text->size()), 0);
-                }
-                if(m_slide->Texts.at(i).Position_type[1] == SizeType::pixels){
-                    text->move(text->x(), m_slide->Texts.at(i).Position.y());
-                }
-                else{
-                    text->move(text->x(),
-                            getYPosition((float)m_slide->Texts.at(i).Position.y() / 100.0f,
-                            m_parentWidget->size(), text->size()));
-                }
-                text->setAlignment((Qt::AlignmentFlag)m_slide->Texts.at(i).Alignment);
-                text->setScaledContents(true);
-                text->setWordWrap(true);
-                
-            }
-        }
+    m_index = index;
+    m_presentation = presentation;
+    m_slide = presentation->GetSlide(index);
+    m_adopted = std::move(renderer);
+    m_imageRequests = token;
+    if(m_timings)
+        m_timings->trackRequests(m_imageRequests);
+    update();
+    if(m_adopted->isComplete())
+        finishFrame();
+}
+
+void PresentationSlideView::adoptedItemReady(size_t item){
+    if(m_adopted)
+        handleItemReady(item);
+}
+
+// Swaps in a new version of the slide on screen. The current frame stays up
+// while changed images load; then only the dirty region of it is re-rendered
+// and repainted.
+void PresentationSlideView::reloadSlide(Presentation* presentation, unsigned int index, const QRegion& dirty){
+    TRACE_SCOPE("PresentationSlideView::reloadSlide", "view");
+    stopTransition();
+    m_imageRequests.cancel();
+    m_imageRequests = ImageRequestToken();
+    m_adopted.reset();
+    m_index = index;
+    m_presentation = presentation;
+    m_slide = presentation ? presentation->GetSlide(index) : nullptr;
+    if(!m_slide){
+        clearSlideView();
+        return;
+    }
+    if(m_frame.isNull()){
+        buildDisplayList();
+        return;
+    }
+    if(dirty.isEmpty() && !m_reloadPending){
+        m_renderer.clear();
+        return;
     }
+    m_reloadRegion += dirty;
+    m_reloadPending = true;
+    m_renderer.setSlide(m_slide, this->size(), this->devicePixelRatioF());
+    m_renderer.requestImages(m_presentation, m_imageRequests, this, [this](size_t){
+        if(m_reloadPending && m_renderer.isComplete())
+            finishReload();
+    });
+    if(m_renderer.isComplete())
+        finishReload();
+}
+
+void PresentationSlideView::finishReload(){
+    TRACE_SCOPE("PresentationSlideView::finishReload", "view");
+    m_reloadPending = false;
+    if(m_frame.size() != m_renderer.frameSize()){
+        m_frame = m_renderer.render();
+        m_reloadRegion = QRegion(rect());
+    }
+    else{
+        // Everything outside the dirty region is unchanged, so only that part
+        // of the frame is painted again.
+        QPainter painter(&m_frame);
+        painter.setClipRegion(m_reloadRegion);
+        m_renderer.paint(painter, m_reloadRegion.boundingRect());
+        painter.end();
+    }
+    update(m_reloadRegion);
+    m_reloadRegion = QRegion();
+    emit frameRendered(m_index, m_frame);
+}
+
+void PresentationSlideView::setTransition(SlideTransitionType type, int duration){
+    stopTransition();
+    m_transition.setType(type);
+    m_transition.setDuration(duration);
+}
+
+void PresentationSlideView::advanceTransition(){
+    TRACE_SCOPE("SlideTransition::advance", "view");
+    if(m_transition.advance())
+        m_transitionTimer->start(m_transition.interval());
+    update();
+}
+
+void PresentationSlideView::stopTransition(){
+    m_transitionTimer->stop();
+    if(m_transition.isRunning())
+        update();
+    m_transition.reset();
+}
+
+void PresentationSlideView::buildDisplayList(){
+    m_reloadPending = false;
+    m_reloadRegion = QRegion();
+    m_imageRequests.cancel();
+    m_imageRequests = ImageRequestToken();
+    m_adopted.reset();
+    m_frame = QImage();
+    if(m_timings)
+        m_timings->trackRequests(m_imageRequests);
+    QElapsedTimer timer;
+    timer.start();
+    m_renderer.setSlide(m_slide, this->size(), this->devicePixelRatioF());
+    m_renderer.requestImages(m_presentation, m_imageRequests, this,
+                             [this](size_t item){ handleItemReady(item); });
+    if(m_timings)
+        m_timings->addLayout(timer.nsecsElapsed() / 1000000.0);
+    update();
+    if(m_renderer.isComplete())
+        finishFrame();
+}
+
+void PresentationSlideView::handleItemReady(size_t item){
+    update(activeRenderer().items().at(item).Rect);
+    if(activeRenderer().isComplete())
+        finishFrame();
+}
+
+void PresentationSlideView::finishFrame(){
+    TRACE_SCOPE("PresentationSlideView::finishFrame", "view");
+    QElapsedTimer timer;
+    timer.start();
+    m_frame = activeRenderer().render();
+    if(m_timings){
+        m_timings->addRender(timer.nsecsElapsed() / 1000000.0);
+        update();
+    }
+    emit frameRendered(m_index, m_frame);
+}
+
+void PresentationSlideView::paintEvent(QPaintEvent *event){
+    TRACE_SCOPE("PresentationSlideView::paintEvent", "view");
+    QPainter painter(this);
+    if(m_transition.isRunning())
+        painter.drawImage(QPoint(0, 0), m_transition.frame());
+    else if(!m_frame.isNull())
+        painter.drawImage(QPoint(0, 0), m_frame);
+    else
+        activeRenderer().paint(painter, event->rect());
+    if(m_timings && m_timings->isActive()){
+        bool complete = !m_transition.isRunning() && !m_frame.isNull();
+        if(complete)
+            m_timings->setTransition(m_transition.stats().Frames, m_transition.stats().MaxFrameMs);
+        if(m_timings->markPainted(complete))
+            emit slidePresented(m_index);
+    }
+}
+
+void PresentationSlideView::resizeEvent(QResizeEvent *event){
+    QWidget::resizeEvent(event);
+    stopTransition();
+    if(!m_frame.isNull() && m_frame.size() != frameSize())
+        buildDisplayList();
+    else if(m_slide && m_frame.isNull() && activeRenderer().size() != this->size())
+        buildDisplayList();
 }
 
 PresentationSlideView::~PresentationSlideView(){
-    if(m_backgroundImage)
-        delete m_backgroundImage;
-    if(m_parentWidget)
-        delete m_parentWidget;
-    m_textWidgets.clear();
-    m_imagesWidgets.clear();
-}
\ No newline at end of file
+    m_imageRequests.cancel();
+}
@@ -20,6 +20,9 @@
 #include <QtGui/QtGui>
 #include <PresentationWindow.hpp>
 #include <Application.hpp>
+#include <SlideDiff.hpp>
+#include <Trace.hpp>
+#include <stdio.h>
 
 PresentationWindow::PresentationWindow(QWidget *parent) : QMainWindow(parent) {    
     this->setWindowTitle("Simple Press 2");
@@ -30,6 +33,7 @@ PresentationWindow::PresentationWindow(QWidget *parent) : QMainWindow(parent) {
     m_closeWindowAction = new QAction(this);
     m_nextSlideAction = new QAction(this);
     m_previousSlideAction = new QAction(this);
+    m_toggleTimingsAction = new QAction(this);
     this->setAttribute(Qt::WA_DeleteOnClose, true);
     QList<QKeySequence> keySequenceList;
 #if __APPLE__
@@ -45,25 +49,222 @@ PresentationWindow::PresentationWindow(QWidget *parent) : QMainWindow(parent) {
     keySequenceList = QList<QKeySequence>();
     keySequenceList << Qt::Key_Left << Qt::Key_H << Qt::Key_A;
     m_previousSlideAction->setShortcuts(keySequenceList);
+
+    keySequenceList = QList<QKeySequence>();
+    keySequenceList << Qt::Key_I << Qt::Key_F3;
+    m_toggleTimingsAction->setShortcuts(keySequenceList);
     connect(m_closeWindowAction, &QAction::triggered, this, &PresentationWindow::handleCloseWindowAction);
     connect(m_nextSlideAction, &QAction::triggered, this, &PresentationWindow::handleNextSlideAction);
     connect(m_previousSlideAction, &QAction::triggered, this, &PresentationWindow::handlePreviousSlideSlideAction);
+    connect(m_toggleTimingsAction, &QAction::triggered, this, &PresentationWindow::handleToggleTimingsAction);
     this->addAction(m_closeWindowAction);
     this->addAction(m_nextSlideAction);
     this->addAction(m_previousSlideAction);
+    this->addAction(m_toggleTimingsAction);
+
+    m_prefetchTimer = new QTimer(this);
+    m_prefetchTimer->setSingleShot(true);
+    m_prefetchTimer->setInterval(0);
+    connect(m_prefetchTimer, &QTimer::timeout, this, &PresentationWindow::prefetchSlides);
+    setTransition(SlideTransition::typeFromString(qEnvironmentVariable("SIMPLEPRESS_TRANSITION")));
+    m_timingExportPath = qEnvironmentVariable("SIMPLEPRESS_TIMINGS");
+    bool ok = false;
+    qint64 ceiling = qEnvironmentVariable("SIMPLEPRESS_MEMORY_LIMIT").toLongLong(&ok);
+    if(ok && ceiling > 0)
+        setMemoryCeiling(ceiling * 1024 * 1024);
+}
+
+PresentationWindow::~PresentationWindow(){
+    releasePresentation();
+    if(!m_timingExportPath.isEmpty() && !exportTimings(m_timingExportPath))
+        printf("[WARNING] Failed to write slide timings to %s.\n", m_timingExportPath.toStdString().c_str());
+}
+
+void PresentationWindow::releasePresentation(){
+    m_prefetchTimer->stop();
+    m_reloadMarked = false;
+    m_timings.cancel();
+    m_residency.detach();
+    if(m_slideView)
+        m_slideView->clearSlideView();
+    clearPrefetchedSlides();
+    m_frameCache.clear();
+    delete m_presentation;
+    m_presentation = nullptr;
+}
+
+void PresentationWindow::setPrefetchWindow(unsigned int window){
+    m_prefetchWindow = window;
+    if(m_presentation)
+        m_prefetchTimer->start();
+}
+
+void PresentationWindow::setFrameCacheBudget(qint64 bytes){
+    m_frameCache.setMaxBytes(bytes);
+    m_residency.trim();
+}
+
+void PresentationWindow::setMemoryCeiling(qint64 bytes){
+    m_residency.setCeiling(bytes);
+}
+
+void PresentationWindow::setTransition(SlideTransitionType type, int duration){
+    m_transitionType = type;
+    m_transitionDuration = duration;
+    if(m_slideView)
+        m_slideView->setTransition(type, duration);
+}
+
+void PresentationWindow::setLiveReload(const QString& filePath){
+    if(m_reloadLoader){
+        m_reloadLoader->cancel();
+        m_reloadLoader->deleteLater();
+    }
+    if(m_reloadWatcher && !m_reloadPath.isEmpty())
+        m_reloadWatcher->removePath(m_reloadPath);
+    m_reloadPath = filePath;
+    if(m_reloadPath.isEmpty()){
+        if(m_reloadTimer)
+            m_reloadTimer->stop();
+        return;
+    }
+    if(!m_reloadWatcher){
+        m_reloadWatcher = new QFileSystemWatcher(this);
+        connect(m_reloadWatcher, &QFileSystemWatcher::fileChanged, this, &PresentationWindow::handleWatchedFileChanged);
+        // Generators usually rewrite the file in several steps; wait until it settles.
+        m_reloadTimer = new QTimer(this);
+        m_reloadTimer->setSingleShot(true);
+        m_reloadTimer->setInterval(500);
+        connect(m_reloadTimer, &QTimer::timeout, this, &PresentationWindow::startReload);
+    }
+    m_reloadWatcher->addPath(m_reloadPath);
+}
+
+void PresentationWindow::handleWatchedFileChanged(){
+    // Images decoded from here on may have been read from the file while it
+    // was being rewritten, so the reload must not carry them over.
+    if(!m_reloadMarked && m_presentation){
+        m_reloadCacheMark = m_presentation->GetImageCache()->insertions();
+        m_reloadMarked = true;
+    }
+    // Replacing the file by rename drops it from the watcher.
+    if(!m_reloadWatcher->files().contains(m_reloadPath) && QFileInfo::exists(m_reloadPath))
+        m_reloadWatcher->addPath(m_reloadPath);
+    m_reloadTimer->start();
+}
+
+void PresentationWindow::startReload(){
+    if(m_reloadPath.isEmpty() || !m_presentation)
+        return;
+    if(m_reloadLoader){
+        m_reloadLoader->cancel();
+        m_reloadLoader->deleteLater();
+    }
+    // A regenerated main.xml gets a new CRC every time, so the slide cache would only pile up files.
+    PresentationLoader* loader = new PresentationLoader(m_reloadPath, PresentationLoadMode::lazy, false, this);
+    loader->setMapArchive(false);
+    m_reloadLoader = loader;
+    connect(loader, &PresentationLoader::loaded, this, &PresentationWindow::reloadPresentation);
+    connect(loader, &PresentationLoader::failed, this, [this](const QString& error){
+        printf("[WARNING] Failed to reload %s. Error: %s\n", m_reloadPath.toStdString().c_str(), error.toStdString().c_str());
+        if(m_reloadWatcher && !m_reloadWatcher->files().contains(m_reloadPath) && QFileInfo::exists(m_reloadPath))
+            m_reloadWatcher->addPath(m_reloadPath);
+    });
+    connect(loader, &PresentationLoader::finished, loader, &QObject::deleteLater);
+    loader->start();
+}
+
+// Replaces the presentation in place. Cached frames of unchanged slides and
+// decoded images of unchanged archive entries are kept, and only the
+// changed parts of the visible slide are repainted.
+void PresentationWindow::reloadPresentation(Presentation* updated){
+    TRACE_SCOPE("PresentationWindow::reloadPresentation", "window");
+    if(!m_presentation || !m_slideView || updated == m_presentation){
+        setPresentation(updated);
+        return;
+    }
+    Presentation* previous = m_presentation;
+    // Nothing may still be reading the old archive, or inserting into the
+    // image cache about to be adopted, once the new deck takes over.
+    clearPrefetchedSlides();
+    previous->DrainImageRequests();
+    const ArchiveIndex& before = previous->GetArchiveIndex();
+    const ArchiveIndex& after = updated->GetArchiveIndex();
+    AssetChangedFunction assetChanged = [&before, &after](const QString& name){ return !before.sameEntry(after, name); };
+    updated->GetImageCache()->setMaxBytes(previous->GetImageCache()->maxBytes());
+    updated->GetImageCache()->adopt(previous->GetImageCache(), [&assetChanged](const QString& name){ return !assetChanged(name); },
+                                    m_reloadMarked ? m_reloadCacheMark : std::numeric_limits<quint64>::max());
+    m_reloadMarked = false;
+
+    unsigned int slideCount = updated->SlideCount();
+    unsigned int current = slideCount ? qMin(m_currentSlide, slideCount - 1) : 0;
+    // Only slides with a cached frame or on screen have anything to invalidate.
+    for(unsigned int index : m_frameCache.indices()){
+        if(index >= slideCount || index >= previous->SlideCount() ||
+            !SlideDiff::compare(previous->GetSlide(index), updated->GetSlide(index), assetChanged).isEmpty())
+            m_frameCache.remove(index);
+    }
+    bool sameSlide = slideCount > 0 && current == m_currentSlide && current < previous->SlideCount();
+    QRegion dirty;
+    if(sameSlide){
+        const PresentationSlide* oldSlide = previous->GetSlide(current);
+        const PresentationSlide* newSlide = updated->GetSlide(current);
+        dirty = SlideDiff::compare(oldSlide, newSlide, assetChanged).dirtyRegion(oldSlide, newSlide, m_slideView->size());
+    }
+
+    m_timings.cancel();
+    m_residency.detach();
+    m_presentation = updated;
+    m_currentSlide = current;
+    m_residency.attach(m_presentation->GetImageCache(), &m_frameCache);
+    if(!m_presentation->Title.isEmpty())
+        this->setWindowTitle("Simple Press 2 - " + m_presentation->Title);
+    if(slideCount == 0){
+        m_slideView->clearSlideView();
+    }
+    else{
+        m_residency.noteSlide(current, m_presentation->GetSlide(current));
+        m_residency.setCurrentSlide(current);
+        if(sameSlide)
+            m_slideView->reloadSlide(m_presentation, current, dirty);
+        else
+            m_slideView->setSlide(m_presentation, current);
+    }
+    if(m_currentSlideLabel){
+        m_currentSlideLabel->setText(QString(QString::number(m_currentSlide + 1) + "/" + QString::number(slideCount)));
+        m_currentSlideLabel->raise();
+    }
+    delete previous;
+    m_prefetchTimer->start();
 }
 
 void PresentationWindow::setPresentation(Presentation *Pres){
+    if(Pres == m_presentation)
+        return;
+    releasePresentation();
     m_presentation = Pres;
     if(!m_presentation->Title.isEmpty() && !m_presentation->Title.isNull())
         this->setWindowTitle("Simple Press 2 - " + m_presentation->Title);
     
-    m_slideView = new PresentationSlideView(this);
+    if(!m_slideView){
+        m_slideView = new PresentationSlideView(this);
+        connect(m_slideView, &PresentationSlideView::frameRendered, this, &PresentationWindow::handleFrameRendered);
+        connect(m_slideView, &PresentationSlideView::slidePresented, this, &PresentationWindow::updateTimingOverlay);
+        m_slideView->setTimingLog(&m_timings);
+        m_slideView->setTransition(m_transitionType, m_transitionDuration);
+    }
+    m_frameCache.setFrameSize(m_slideView->frameSize());
+    m_residency.attach(m_presentation->GetImageCache(), &m_frameCache);
     m_currentSlide = 0;
-    if(m_presentation->Slides.size() > 0){
+    m_slideView->clearSlideView();
+    if(m_presentation->SlideCount() > 0){
+        m_timings.begin(m_currentSlide);
+        m_residency.noteSlide(m_currentSlide, m_presentation->GetSlide(m_currentSlide));
         m_slideView->setSlide(m_presentation, m_currentSlide);
         m_slideView->show();
-        m_currentSlideLabel = new QLabel(QString("1/" + QString::number(m_presentation->Slides.size())), this);
+        if(m_currentSlideLabel)
+            m_currentSlideLabel->deleteLater();
+        m_currentSlideLabel = new QLabel(QString("1/" + QString::number(m_presentation->SlideCount())), this);
         m_currentSlideLabel->setScaledContents(true);
         QFont font = QFont(m_currentSlideLabel->font());
         font.setPixelSize((int)((float)height() / 400.0f * 8));
@@ -71,6 +272,51 @@ void PresentationWindow::setPresentation(Presentation *Pres){
         m_currentSlideLabel->move(width() - m_currentSlideLabel->width() * 0.6f,
                                   height() - m_currentSlideLabel->height());
         m_currentSlideLabel->show();
+        updateTimingOverlay();
+        m_prefetchTimer->start();
+    }
+}
+
+bool PresentationWindow::exportTimings(const QString& path) const{
+    return m_timings.exportFile(path);
+}
+
+void PresentationWindow::setTimingOverlayVisible(bool visible){
+    if(!m_timingLabel){
+        if(!visible)
+            return;
+        m_timingLabel = new QLabel(this);
+        m_timingLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        m_timingLabel->setStyleSheet("QLabel { background-color: rgba(0, 0, 0, 160); color: white; padding: 6px; }");
+    }
+    m_timingLabel->setVisible(visible);
+    updateTimingOverlay();
+}
+
+void PresentationWindow::handleToggleTimingsAction(){
+    setTimingOverlayVisible(!m_timingLabel || m_timingLabel->isHidden());
+}
+
+void PresentationWindow::updateTimingOverlay(){
+    if(!m_timingLabel || m_timingLabel->isHidden())
+        return;
+    m_timingLabel->setText(m_timings.summary() + "\n" + m_residency.summary());
+    m_timingLabel->adjustSize();
+    int right = m_currentSlideLabel ? m_currentSlideLabel->x() - 10 : width();
+    m_timingLabel->move(qMax(0, right - m_timingLabel->width()), height() - m_timingLabel->height());
+    m_timingLabel->raise();
+}
+
+void PresentationWindow::resizeEvent(QResizeEvent *event){
+    QMainWindow::resizeEvent(event);
+    if(!m_slideView)
+        return;
+    m_slideView->setGeometry(PresentationSlideView::slideGeometry(this->size()));
+    if(m_frameCache.frameSize() != m_slideView->frameSize()){
+        m_frameCache.setFrameSize(m_slideView->frameSize());
+        clearPrefetchedSlides();
+        if(m_presentation)
+            m_prefetchTimer->start();
     }
 }
 
@@ -88,33 +334,110 @@ void PresentationWindow::handleCloseWindowAction(){
 }
 
 void PresentationWindow::handleNextSlideAction(){
-    if(m_currentSlide + 1 != m_presentation->Slides.size() && m_presentation->Slides.size() > 1){
-        m_currentSlide++;
-        PresentationSlideView* newSlideView = new PresentationSlideView(this);
-        newSlideView->setSlide(m_presentation, m_currentSlide);
-        newSlideView->show();
-        m_slideView->hide();
-        m_slideView->deleteLater();
-        m_slideView = newSlideView;
-        if(m_currentSlideLabel){
-           m_currentSlideLabel->setText(QString(QString::number(m_currentSlide + 1) + "/" + QString::number(m_presentation->Slides.size())));
-           m_currentSlideLabel->raise();
-        }
+    TRACE_SCOPE("PresentationWindow::handleNextSlideAction", "window");
+    if(m_currentSlide + 1 != m_presentation->SlideCount() && m_presentation->SlideCount() > 1){
+        showSlide(m_currentSlide + 1);
     }
 }
 
 void PresentationWindow::handlePreviousSlideSlideAction(){
+    TRACE_SCOPE("PresentationWindow::handlePreviousSlideAction", "window");
     if(m_currentSlide){
-        m_currentSlide--;
-        PresentationSlideView* newSlideView = new PresentationSlideView(this);
-        newSlideView->setSlide(m_presentation, m_currentSlide);
-        newSlideView->show();
-        m_slideView->hide();
-        m_slideView->deleteLater();
-        m_slideView = newSlideView;
-        if(m_currentSlideLabel){
-           m_currentSlideLabel->setText(QString(QString::number(m_currentSlide + 1) + "/" + QString::number(m_presentation->Slides.size())));
-           m_currentSlideLabel->raise();
-        }
-    }
-}
\ No newline at end of file
+        showSlide(m_currentSlide - 1);
+    }
+}
+
+void PresentationWindow::showSlide(unsigned int index){
+    TRACE_SCOPE("PresentationWindow::showSlide", "window");
+    bool reverse = index < m_currentSlide;
+    m_currentSlide = index;
+    QImage frame;
+    bool cached = m_frameCache.find(index, &frame);
+    std::unique_ptr<PendingFrame> pending;
+    auto it = m_pendingFrames.find(index);
+    if(it != m_pendingFrames.end()){
+        pending = std::move(it->second);
+        m_pendingFrames.erase(it);
+    }
+    m_timings.begin(index);
+    m_timings.setCached(cached);
+    m_residency.noteSlide(index, m_presentation->GetSlide(index));
+    m_residency.setCurrentSlide(index);
+    if(cached)
+        m_slideView->setFrame(m_presentation, index, frame, true, reverse);
+    else if(pending && pending->Renderer->size() == m_slideView->size())
+        m_slideView->adoptSlide(m_presentation, index, std::move(pending->Renderer), pending->Token);
+    else
+        m_slideView->setSlide(m_presentation, index);
+    if(m_currentSlideLabel){
+       m_currentSlideLabel->setText(QString(QString::number(m_currentSlide + 1) + "/" + QString::number(m_presentation->SlideCount())));
+       m_currentSlideLabel->raise();
+    }
+    m_prefetchTimer->start();
+    if(cached)
+        emit slideShown(index);
+}
+
+void PresentationWindow::handleFrameRendered(unsigned int index, const QImage& frame){
+    m_frameCache.insert(index, frame);
+    m_residency.trim();
+    if(index == m_currentSlide)
+        emit slideShown(index);
+}
+
+void PresentationWindow::prefetchSlides(){
+    TRACE_SCOPE("PresentationWindow::prefetchSlides", "window");
+    if(!m_presentation || !m_slideView)
+        return;
+    unsigned int slideCount = m_presentation->SlideCount();
+    for(auto it = m_pendingFrames.begin(); it != m_pendingFrames.end();){
+        unsigned int distance = it->first > m_currentSlide ? it->first - m_currentSlide : m_currentSlide - it->first;
+        if(distance > m_prefetchWindow || distance == 0 || it->first >= slideCount)
+            it = m_pendingFrames.erase(it);
+        else
+            it++;
+    }
+    for(unsigned int distance = 1; distance <= m_prefetchWindow; distance++){
+        if(m_currentSlide + distance < slideCount)
+            prefetchFrame(m_currentSlide + distance);
+        if(m_currentSlide >= distance)
+            prefetchFrame(m_currentSlide - distance);
+    }
+}
+
+void PresentationWindow::prefetchFrame(unsigned int index){
+    if(m_frameCache.contains(index) || m_pendingFrames.count(index) || !m_presentation->GetSlide(index))
+        return;
+    m_residency.noteSlide(index, m_presentation->GetSlide(index));
+    PendingFrame* pending = new PendingFrame;
+    m_pendingFrames[index] = std::unique_ptr<PendingFrame>(pending);
+    pending->Renderer->setSlide(m_presentation->GetSlide(index), m_slideView->size(), m_slideView->devicePixelRatioF());
+    pending->Renderer->requestImages(m_presentation, pending->Token, this,
+                                     [this, index](size_t item){ handlePendingItem(index, item); });
+    completePendingFrame(index);
+}
+
+// A prefetch that was still running when its slide came up now belongs to the
+// slide view; its remaining images are forwarded there.
+void PresentationWindow::handlePendingItem(unsigned int index, size_t item){
+    if(m_pendingFrames.count(index))
+        completePendingFrame(index);
+    else if(m_slideView->slideIndex() == index)
+        m_slideView->adoptedItemReady(item);
+    m_residency.trim();
+}
+
+void PresentationWindow::completePendingFrame(unsigned int index){
+    auto it = m_pendingFrames.find(index);
+    if(it == m_pendingFrames.end() || !it->second->Renderer->isComplete())
+        return;
+    TRACE_SCOPE("PresentationWindow::completePendingFrame", "window");
+    m_frameCache.insert(index, it->second->Renderer->render());
+    m_pendingFrames.erase(it);
+    m_residency.trim();
+}
+
+void PresentationWindow::clearPrefetchedSlides(){
+    m_prefetchTimer->stop();
+    m_pendingFrames.clear();
+}
@@ -0,0 +1,173 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <ResidencyManager.hpp>
+#include <algorithm>
+#include <limits>
+
+// Trimming stops a little below the caps so the next few inserts do not
+// immediately fall back to LRU eviction.
+static const qint64 TrimNumerator = 9;
+static const qint64 TrimDenominator = 10;
+
+ResidencyManager::ResidencyManager(qint64 ceiling) : m_ceiling(qMax<qint64>(0, ceiling)) { }
+
+void ResidencyManager::setCeiling(qint64 bytes){
+    m_ceiling = qMax<qint64>(0, bytes);
+    applyCaps();
+    trim();
+}
+
+qint64 ResidencyManager::ceiling() const{
+    if(hasCeiling())
+        return m_ceiling;
+    return (m_images ? m_images->maxBytes() : 0) + (m_frames ? m_frames->maxBytes() : 0);
+}
+
+void ResidencyManager::applyCaps(){
+    if(!hasCeiling())
+        return;
+    // Frames are cheap to rebuild from cached images, images are not, so
+    // images get the larger share.
+    if(m_images)
+        m_images->setMaxBytes(m_ceiling * 5 / 8);
+    if(m_frames)
+        m_frames->setMaxBytes(m_ceiling * 3 / 8);
+}
+
+void ResidencyManager::attach(ImageCache* images, SlideFrameCache* frames){
+    detach();
+    m_images = images;
+    m_frames = frames;
+    m_current = 0;
+    applyCaps();
+}
+
+void ResidencyManager::detach(){
+    m_images = nullptr;
+    m_frames = nullptr;
+    m_imageSlides.clear();
+    m_slideImages.clear();
+}
+
+void ResidencyManager::noteSlide(unsigned int index, const PresentationSlide* slide){
+    if(!slide || m_slideImages.contains(index))
+        return;
+    std::vector<QString> names;
+    if(!slide->SlideBackgroundFileName.isEmpty())
+        names.push_back(slide->SlideBackgroundFileName);
+    for(const PresentationImage& image : slide->Images)
+        names.push_back(image.FileName);
+    for(const QString& name : names)
+        m_imageSlides[name].push_back(index);
+    m_slideImages.insert(index, names);
+    updatePeak();
+}
+
+void ResidencyManager::setCurrentSlide(unsigned int index){
+    m_current = index;
+    trim();
+}
+
+unsigned int ResidencyManager::distance(unsigned int index) const{
+    return index > m_current ? index - m_current : m_current - index;
+}
+
+unsigned int ResidencyManager::imageDistance(const QString& name) const{
+    // Images not seen on any slide yet (e.g. loaded through GetImage) go first.
+    auto it = m_imageSlides.constFind(name);
+    if(it == m_imageSlides.constEnd())
+        return std::numeric_limits<unsigned int>::max();
+    unsigned int nearest = std::numeric_limits<unsigned int>::max();
+    for(unsigned int index : it.value())
+        nearest = qMin(nearest, distance(index));
+    return nearest;
+}
+
+qint64 ResidencyManager::usedBytes() const{
+    return (m_images ? m_images->usedBytes() : 0) + (m_frames ? m_frames->usedBytes() : 0);
+}
+
+void ResidencyManager::updatePeak(){
+    m_peak = qMax(m_peak, usedBytes());
+}
+
+qint64 ResidencyManager::slideBytes(unsigned int index) const{
+    qint64 bytes = 0;
+    if(m_frames && m_frames->contains(index))
+        bytes += m_frames->frameBytes();
+    if(!m_images)
+        return bytes;
+    auto names = m_slideImages.constFind(index);
+    if(names == m_slideImages.constEnd())
+        return bytes;
+    for(const std::pair<QString, qint64>& entry : m_images->entries()){
+        if(std::find(names.value().begin(), names.value().end(), entry.first) != names.value().end())
+            bytes += entry.second;
+    }
+    return bytes;
+}
+
+void ResidencyManager::trim(){
+    if(!m_images || !m_frames)
+        return;
+    qint64 imageBytes = m_images->usedBytes();
+    qint64 frameBytes = m_frames->usedBytes();
+    m_peak = qMax(m_peak, imageBytes + frameBytes);
+    qint64 imageTarget = m_images->maxBytes() * TrimNumerator / TrimDenominator;
+    qint64 frameTarget = m_frames->maxBytes() * TrimNumerator / TrimDenominator;
+    if(imageBytes <= imageTarget && frameBytes <= frameTarget)
+        return;
+
+    std::vector<Candidate> candidates;
+    if(imageBytes > imageTarget){
+        for(const std::pair<QString, qint64>& entry : m_images->entries())
+            candidates.push_back({ imageDistance(entry.first), false, 0, entry.first, entry.second });
+    }
+    if(frameBytes > frameTarget){
+        for(unsigned int index : m_frames->indices())
+            candidates.push_back({ distance(index), true, index, QString(), m_frames->frameBytes() });
+    }
+    // Farthest first; at equal distance drop the frame, which is cheaper to
+    // rebuild than the decoded images it was rendered from.
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b){
+        if(a.Distance != b.Distance)
+            return a.Distance > b.Distance;
+        return a.Frame && !b.Frame;
+    });
+    for(const Candidate& candidate : candidates){
+        if(candidate.Distance == 0)
+            break;
+        if(candidate.Frame && frameBytes > frameTarget){
+            m_frames->remove(candidate.Index);
+            frameBytes -= candidate.Bytes;
+            m_evicted += candidate.Bytes;
+        }
+        else if(!candidate.Frame && imageBytes > imageTarget){
+            m_images->remove(candidate.Name);
+            imageBytes -= candidate.Bytes;
+            m_evicted += candidate.Bytes;
+        }
+        if(imageBytes <= imageTarget && frameBytes <= frameTarget)
+            break;
+    }
+}
+
+QString ResidencyManager::summary() const{
+    const double MiB = 1024.0 * 1024.0;
+    return QString("memory %1 MiB (peak %2, ceiling %3), slide %4 MiB").arg(usedBytes() / MiB, 0, 'f', 1)
+           .arg(m_peak / MiB, 0, 'f', 1).arg(ceiling() / MiB, 0, 'f', 0).arg(slideBytes(m_current) / MiB, 0, 'f', 1);
+}
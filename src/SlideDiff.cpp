@@ -0,0 +1,87 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <SlideDiff.hpp>
+#include <SlideRenderer.hpp>
+
+bool SlideDiff::sameText(const PresentationText& a, const PresentationText& b){
+    return a.Text == b.Text && a.Position == b.Position && a.Size == b.Size && a.Alignment == b.Alignment &&
+           a.fontSize == b.fontSize && a.FontColor == b.FontColor && a.fontSizeType == b.fontSizeType &&
+           a.Position_type[0] == b.Position_type[0] && a.Position_type[1] == b.Position_type[1] &&
+           a.Size_type[0] == b.Size_type[0] && a.Size_type[1] == b.Size_type[1] &&
+           a.isBold == b.isBold && a.isItalic == b.isItalic && a.isUnderlined == b.isUnderlined &&
+           a.isStrikedOut == b.isStrikedOut;
+}
+
+bool SlideDiff::sameImage(const PresentationImage& a, const PresentationImage& b){
+    return a.FileName == b.FileName && a.Alt == b.Alt && a.Position == b.Position && a.Size == b.Size &&
+           a.Position_type[0] == b.Position_type[0] && a.Position_type[1] == b.Position_type[1] &&
+           a.Size_type[0] == b.Size_type[0] && a.Size_type[1] == b.Size_type[1];
+}
+
+SlideDiff SlideDiff::compare(const PresentationSlide* before, const PresentationSlide* after,
+                             const AssetChangedFunction& assetChanged){
+    SlideDiff diff;
+    if(!before || !after){
+        diff.m_layout = before != after;
+        return diff;
+    }
+    diff.m_background = before->SlideBackgroundFileName != after->SlideBackgroundFileName ||
+                        before->hasBackgroundColor != after->hasBackgroundColor ||
+                        (after->hasBackgroundColor && before->SlideBackgroundColor != after->SlideBackgroundColor) ||
+                        (!after->SlideBackgroundFileName.isEmpty() && assetChanged(after->SlideBackgroundFileName));
+    if(before->Images.size() != after->Images.size() || before->Texts.size() != after->Texts.size()){
+        diff.m_layout = true;
+        return diff;
+    }
+    for(size_t i = 0; i < after->Images.size(); i++){
+        if(!sameImage(before->Images[i], after->Images[i]) || assetChanged(after->Images[i].FileName))
+            diff.m_images.push_back(i);
+    }
+    for(size_t i = 0; i < after->Texts.size(); i++){
+        if(!sameText(before->Texts[i], after->Texts[i]))
+            diff.m_texts.push_back(i);
+    }
+    return diff;
+}
+
+QRegion SlideDiff::dirtyRegion(const PresentationSlide* before, const PresentationSlide* after, const QSize& size) const{
+    QRect slideRect(QPoint(0, 0), size);
+    if(m_background || m_layout || !before || !after)
+        return isEmpty() ? QRegion() : QRegion(slideRect);
+    // Display items are the background image (if any), then images, then
+    // texts, in slide order; old and new rects both need repainting.
+    SlideRenderer oldLayout, newLayout;
+    oldLayout.setSlide(before, size);
+    newLayout.setSlide(after, size);
+    size_t oldFirst = before->SlideBackgroundFileName.isEmpty() ? 0 : 1;
+    size_t newFirst = after->SlideBackgroundFileName.isEmpty() ? 0 : 1;
+    QRegion dirty;
+    for(size_t i : m_images){
+        dirty += oldLayout.items().at(oldFirst + i).Rect;
+        dirty += newLayout.items().at(newFirst + i).Rect;
+    }
+    oldFirst += before->Images.size();
+    newFirst += after->Images.size();
+    for(size_t i : m_texts){
+        // Wrapped text is not clipped to its rect, so leave some slack.
+        for(const SlideDisplayItem* item : { &oldLayout.items().at(oldFirst + i), &newLayout.items().at(newFirst + i) }){
+            int slack = item->Font.pixelSize() / 2 + 2;
+            dirty += item->Rect.adjusted(-slack, -slack, slack, slack);
+        }
+    }
+    return dirty.intersected(slideRect);
+}
@@ -0,0 +1,55 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#include <SlideFrameCache.hpp>
+
+SlideFrameCache::SlideFrameCache(qint64 maxBytes){
+    m_frames.setMaxCost(maxBytes);
+}
+
+void SlideFrameCache::setMaxBytes(qint64 maxBytes){
+    m_frames.setMaxCost(maxBytes);
+}
+
+void SlideFrameCache::setFrameSize(const QSize& size){
+    if(size == m_frameSize)
+        return;
+    m_frames.clear();
+    m_frameSize = size;
+}
+
+bool SlideFrameCache::find(unsigned int index, QImage* frame){
+    QImage* cached = m_frames.object(index);
+    if(!cached)
+        return false;
+    *frame = *cached;
+    return true;
+}
+
+void SlideFrameCache::insert(unsigned int index, const QImage& frame){
+    if(frame.isNull() || frame.size() != m_frameSize)
+        return;
+    m_frames.insert(index, new QImage(frame), qMax<qint64>(frame.sizeInBytes(), 1));
+}
+
+void SlideFrameCache::remove(unsigned int index){
+    m_frames.remove(index);
+}
+
+void SlideFrameCache::clear(){
+    m_frames.clear();
+}
@@ -0,0 +1,370 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <SlideModelCache.hpp>
+
+#define MODEL_CACHE_VERSION 1
+
+namespace {
+
+struct CacheHeader
+{
+    char Magic[8];
+    quint32 ByteOrder;
+    quint32 Version;
+    quint32 XMLCrc;
+    quint32 Reserved;
+    quint64 XMLSize;
+    quint32 Title;
+    quint32 SlideCount;
+    quint32 TextCount;
+    quint32 ImageCount;
+    quint32 StringCount;
+    quint32 StringDataLength;
+};
+
+struct SlideRecord
+{
+    quint32 Title;
+    quint32 Background;
+    quint32 BackgroundColor;
+    quint32 HasBackgroundColor;
+    quint32 FirstText;
+    quint32 TextCount;
+    quint32 FirstImage;
+    quint32 ImageCount;
+};
+
+struct TextRecord
+{
+    quint32 Text;
+    qint32 X, Y, Width, Height;
+    qint32 Alignment;
+    qint32 FontSize;
+    quint32 FontColor;
+    quint8 FontSizeType;
+    quint8 PositionTypes[2];
+    quint8 SizeTypes[2];
+    quint8 Flags;
+    quint8 Reserved[2];
+};
+
+struct ImageRecord
+{
+    quint32 FileName;
+    quint32 Alt;
+    qint32 X, Y, Width, Height;
+    quint8 PositionTypes[2];
+    quint8 SizeTypes[2];
+};
+
+struct StringRecord
+{
+    quint32 Offset;
+    quint32 Length;
+};
+
+static_assert(sizeof(CacheHeader) == 56, "unexpected CacheHeader layout");
+static_assert(sizeof(SlideRecord) == 32, "unexpected SlideRecord layout");
+static_assert(sizeof(TextRecord) == 40, "unexpected TextRecord layout");
+static_assert(sizeof(ImageRecord) == 28, "unexpected ImageRecord layout");
+static_assert(sizeof(StringRecord) == 8, "unexpected StringRecord layout");
+
+const char CacheMagic[8] = { 'S', 'P', 'R', 'E', 'S', 'M', 'D', 'L' };
+const quint32 CacheByteOrder = 0x01020304;
+
+enum TextFlags : quint8{
+    bold = 1,
+    italic = 2,
+    underlined = 4,
+    strikedOut = 8
+};
+
+class StringTable
+{
+public:
+    StringTable() { m_records.push_back({ 0, 0 }); }
+    quint32 add(const QString& string)
+    {
+        if(string.isEmpty())
+            return 0;
+        auto it = m_indices.constFind(string);
+        if(it != m_indices.constEnd())
+            return *it;
+        quint32 index = (quint32)m_records.size();
+        m_records.push_back({ (quint32)m_data.size(), (quint32)string.size() });
+        m_data.insert(m_data.end(), string.utf16(), string.utf16() + string.size());
+        m_indices.insert(string, index);
+        return index;
+    }
+    const std::vector<StringRecord>& records() const { return m_records; }
+    const std::vector<char16_t>& data() const { return m_data; }
+private:
+    QHash<QString, quint32> m_indices;
+    std::vector<StringRecord> m_records;
+    std::vector<char16_t> m_data;
+};
+
+inline bool ValidSizeType(quint8 type){
+    return type <= SizeType::percent;
+}
+
+}
+
+SlideModelCache::~SlideModelCache(){
+    close();
+}
+
+QString SlideModelCache::cachePath(quint32 xmlCrc, quint64 xmlSize){
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(directory.isEmpty())
+        return QString();
+    return directory + "/slides/" + QString("%1-%2.spc").arg(xmlCrc, 8, 16, QChar('0')).arg(xmlSize);
+}
+
+bool SlideModelCache::save(const QString& path, quint32 xmlCrc, quint64 xmlSize, const QString& title,
+                           const std::vector<PresentationSlide>& slides){
+    StringTable strings;
+    std::vector<SlideRecord> slideRecords;
+    std::vector<TextRecord> textRecords;
+    std::vector<ImageRecord> imageRecords;
+    slideRecords.reserve(slides.size());
+    for(const PresentationSlide& slide : slides){
+        SlideRecord record = {};
+        record.Title = strings.add(slide.SlideTitle);
+        record.Background = strings.add(slide.SlideBackgroundFileName);
+        record.BackgroundColor = slide.SlideBackgroundColor;
+        record.HasBackgroundColor = slide.hasBackgroundColor;
+        record.FirstText = (quint32)textRecords.size();
+        record.TextCount = (quint32)slide.Texts.size();
+        record.FirstImage = (quint32)imageRecords.size();
+        record.ImageCount = (quint32)slide.Images.size();
+        for(const PresentationText& text : slide.Texts){
+            TextRecord t = {};
+            t.Text = strings.add(text.Text);
+            t.X = text.Position.x();
+            t.Y = text.Position.y();
+            t.Width = text.Size.width();
+            t.Height = text.Size.height();
+            t.Alignment = text.Alignment;
+            t.FontSize = text.fontSize;
+            t.FontColor = text.FontColor;
+            t.FontSizeType = text.fontSizeType;
+            t.PositionTypes[0] = text.Position_type[0];
+            t.PositionTypes[1] = text.Position_type[1];
+            t.SizeTypes[0] = text.Size_type[0];
+            t.SizeTypes[1] = text.Size_type[1];
+            t.Flags = (quint8)((text.isBold ? TextFlags::bold : 0) | (text.isItalic ? TextFlags::italic : 0) |
+                      (text.isUnderlined ? TextFlags::underlined : 0) | (text.isStrikedOut ? TextFlags::strikedOut : 0));
+            textRecords.push_back(t);
+        }
+        for(const PresentationImage& image : slide.Images){
+            ImageRecord i = {};
+            i.FileName = strings.add(image.FileName);
+            i.Alt = strings.add(image.Alt);
+            i.X = image.Position.x();
+            i.Y = image.Position.y();
+            i.Width = image.Size.width();
+            i.Height = image.Size.height();
+            i.PositionTypes[0] = image.Position_type[0];
+            i.PositionTypes[1] = image.Position_type[1];
+            i.SizeTypes[0] = image.Size_type[0];
+            i.SizeTypes[1] = image.Size_type[1];
+            imageRecords.push_back(i);
+        }
+        slideRecords.push_back(record);
+    }
+
+    CacheHeader header = {};
+    memcpy(header.Magic, CacheMagic, sizeof(CacheMagic));
+    header.ByteOrder = CacheByteOrder;
+    header.Version = MODEL_CACHE_VERSION;
+    header.XMLCrc = xmlCrc;
+    header.XMLSize = xmlSize;
+    header.Title = strings.add(title);
+    header.SlideCount = (quint32)slideRecords.size();
+    header.TextCount = (quint32)textRecords.size();
+    header.ImageCount = (quint32)imageRecords.size();
+    header.StringCount = (quint32)strings.records().size();
+    header.StringDataLength = (quint32)strings.data().size();
+
+    if(!QDir().mkpath(QFileInfo(path).absolutePath()))
+        return false;
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)slideRecords.data(), slideRecords.size() * sizeof(SlideRecord));
+    file.write((const char*)textRecords.data(), textRecords.size() * sizeof(TextRecord));
+    file.write((const char*)imageRecords.data(), imageRecords.size() * sizeof(ImageRecord));
+    file.write((const char*)strings.records().data(), strings.records().size() * sizeof(StringRecord));
+    file.write((const char*)strings.data().data(), strings.data().size() * sizeof(char16_t));
+    if(!file.commit())
+        return false;
+    prune(path);
+    return true;
+}
+
+// Every edited version of a deck gets its own file, so the directory is kept
+// under maxBytes by deleting the least recently used files first. open()
+// touches a file on every hit, which makes its modification time the last use.
+void SlideModelCache::prune(const QString& keepPath, qint64 maxBytes){
+    QFileInfo keep(keepPath);
+    QFileInfoList files = keep.absoluteDir().entryInfoList(QStringList() << "*.spc", QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+    for(const QFileInfo& file : files)
+        total += file.size();
+    for(const QFileInfo& file : files){
+        if(total <= maxBytes)
+            break;
+        if(file.absoluteFilePath() == keep.absoluteFilePath())
+            continue;
+        if(QFile::remove(file.absoluteFilePath()))
+            total -= file.size();
+    }
+}
+
+bool SlideModelCache::open(const QString& path, quint32 xmlCrc, quint64 xmlSize){
+    close();
+    m_file.setFileName(path);
+    if(!m_file.open(QIODevice::ReadOnly))
+        return false;
+    m_size = m_file.size();
+    if(m_size < (qint64)sizeof(CacheHeader) || !(m_data = m_file.map(0, m_size))){
+        close();
+        return false;
+    }
+    const CacheHeader* header = (const CacheHeader*)m_data;
+    if(memcmp(header->Magic, CacheMagic, sizeof(CacheMagic)) || header->ByteOrder != CacheByteOrder ||
+        header->Version != MODEL_CACHE_VERSION || header->XMLCrc != xmlCrc || header->XMLSize != xmlSize || !validate()){
+        close();
+        return false;
+    }
+    QFile touch(path);
+    if(touch.open(QIODevice::Append))
+        touch.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+bool SlideModelCache::validate() const{
+    const CacheHeader* header = (const CacheHeader*)m_data;
+    quint64 expected = sizeof(CacheHeader) + (quint64)header->SlideCount * sizeof(SlideRecord) +
+                       (quint64)header->TextCount * sizeof(TextRecord) + (quint64)header->ImageCount * sizeof(ImageRecord) +
+                       (quint64)header->StringCount * sizeof(StringRecord) + (quint64)header->StringDataLength * sizeof(char16_t);
+    if(expected != (quint64)m_size || !header->StringCount || header->Title >= header->StringCount)
+        return false;
+    const SlideRecord* slides = (const SlideRecord*)(header + 1);
+    const TextRecord* texts = (const TextRecord*)(slides + header->SlideCount);
+    const ImageRecord* images = (const ImageRecord*)(texts + header->TextCount);
+    const StringRecord* strings = (const StringRecord*)(images + header->ImageCount);
+    for(quint32 i = 0; i < header->StringCount; i++){
+        if((quint64)strings[i].Offset + strings[i].Length > header->StringDataLength)
+            return false;
+    }
+    for(quint32 i = 0; i < header->SlideCount; i++){
+        const SlideRecord& slide = slides[i];
+        if(slide.Title >= header->StringCount || slide.Background >= header->StringCount ||
+            (quint64)slide.FirstText + slide.TextCount > header->TextCount ||
+            (quint64)slide.FirstImage + slide.ImageCount > header->ImageCount)
+            return false;
+    }
+    for(quint32 i = 0; i < header->TextCount; i++){
+        const TextRecord& text = texts[i];
+        if(text.Text >= header->StringCount || !ValidSizeType(text.FontSizeType) ||
+            !ValidSizeType(text.PositionTypes[0]) || !ValidSizeType(text.PositionTypes[1]) ||
+            !ValidSizeType(text.SizeTypes[0]) || !ValidSizeType(text.SizeTypes[1]))
+            return false;
+    }
+    for(quint32 i = 0; i < header->ImageCount; i++){
+        const ImageRecord& image = images[i];
+        if(image.FileName >= header->StringCount || image.Alt >= header->StringCount ||
+            !ValidSizeType(image.PositionTypes[0]) || !ValidSizeType(image.PositionTypes[1]) ||
+            !ValidSizeType(image.SizeTypes[0]) || !ValidSizeType(image.SizeTypes[1]))
+            return false;
+    }
+    return true;
+}
+
+void SlideModelCache::load(PresentationSlideStore* store, std::vector<PresentationSlide>* slides, QString* title) const{
+    if(!m_data)
+        return;
+    const CacheHeader* header = (const CacheHeader*)m_data;
+    const SlideRecord* slideRecords = (const SlideRecord*)(header + 1);
+    const TextRecord* textRecords = (const TextRecord*)(slideRecords + header->SlideCount);
+    const ImageRecord* imageRecords = (const ImageRecord*)(textRecords + header->TextCount);
+    const StringRecord* stringRecords = (const StringRecord*)(imageRecords + header->ImageCount);
+    const char16_t* stringData = (const char16_t*)(stringRecords + header->StringCount);
+
+    std::vector<QString> strings(header->StringCount);
+    for(quint32 i = 1; i < header->StringCount; i++)
+        strings[i] = QString::fromUtf16(stringData + stringRecords[i].Offset, stringRecords[i].Length);
+    *title = strings[header->Title];
+
+    std::vector<PresentationText> texts;
+    std::vector<PresentationImage> images;
+    slides->resize(header->SlideCount);
+    for(quint32 i = 0; i < header->SlideCount; i++){
+        const SlideRecord& record = slideRecords[i];
+        PresentationSlide& slide = (*slides)[i];
+        slide.SlideTitle = strings[record.Title];
+        slide.SlideBackgroundFileName = strings[record.Background];
+        slide.SlideBackgroundColor = record.BackgroundColor;
+        slide.hasBackgroundColor = record.HasBackgroundColor;
+        texts.resize(record.TextCount);
+        for(quint32 j = 0; j < record.TextCount; j++){
+            const TextRecord& r = textRecords[record.FirstText + j];
+            PresentationText& text = texts[j];
+            text.Text = strings[r.Text];
+            text.Position = QPoint(r.X, r.Y);
+            text.Size = QSize(r.Width, r.Height);
+            text.Alignment = r.Alignment;
+            text.fontSize = r.FontSize;
+            text.FontColor = r.FontColor;
+            text.fontSizeType = (SizeType)r.FontSizeType;
+            text.Position_type[0] = (SizeType)r.PositionTypes[0];
+            text.Position_type[1] = (SizeType)r.PositionTypes[1];
+            text.Size_type[0] = (SizeType)r.SizeTypes[0];
+            text.Size_type[1] = (SizeType)r.SizeTypes[1];
+            text.isBold = r.Flags & TextFlags::bold;
+            text.isItalic = r.Flags & TextFlags::italic;
+            text.isUnderlined = r.Flags & TextFlags::underlined;
+            text.isStrikedOut = r.Flags & TextFlags::strikedOut;
+        }
+        images.resize(record.ImageCount);
+        for(quint32 j = 0; j < record.ImageCount; j++){
+            const ImageRecord& r = imageRecords[record.FirstImage + j];
+            PresentationImage& image = images[j];
+            image.FileName = strings[r.FileName];
+            image.Alt = strings[r.Alt];
+            image.Position = QPoint(r.X, r.Y);
+            image.Size = QSize(r.Width, r.Height);
+            image.Position_type[0] = (SizeType)r.PositionTypes[0];
+            image.Position_type[1] = (SizeType)r.PositionTypes[1];
+            image.Size_type[0] = (SizeType)r.SizeTypes[0];
+            image.Size_type[1] = (SizeType)r.SizeTypes[1];
+        }
+        slide.Texts = store->Texts.allocate(texts);
+        slide.Images = store->Images.allocate(images);
+    }
+}
+
+void SlideModelCache::close(){
+    if(m_data)
+        m_file.unmap((uchar*)m_data);
+    m_data = nullptr;
+    m_size = 0;
+    m_file.close();
+}
@@ -0,0 +1,209 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#include <SlideRenderer.hpp>
+#include <stdio.h>
+
+static int getXPosition(const float percentXPosition, const QSize& screenSize, const QSize& widgetSize){
+    return (int)(percentXPosition * (float)screenSize.width()) - (int)((float)widgetSize.width() / 2.0f);
+}
+
+static int getYPosition(const float percentYPosition, const QSize& screenSize, const QSize& widgetSize){
+    return (int)((float)-(percentYPosition - 1) * (float)screenSize.height()) - (int)((float)widgetSize.height() / 2.0f);
+}
+
+static QRect getItemRect(const QSize& screenSize, const QPoint& position, const SizeType positionType[2],
+                         const QSize& size, const SizeType sizeType[2]){
+    QSize itemSize;
+    if(sizeType[0] == SizeType::pixels)
+        itemSize.setWidth(size.width());
+    else
+        itemSize.setWidth(size.width() / 100.0f * screenSize.width());
+    if(sizeType[1] == SizeType::pixels)
+        itemSize.setHeight(size.height());
+    else
+        itemSize.setHeight(size.height() / 100.0f * screenSize.height());
+    QPoint itemPosition;
+    if(positionType[0] == SizeType::pixels)
+        itemPosition.setX(position.x());
+    else
+        itemPosition.setX(getXPosition((float)position.x() / 100.0f, screenSize, itemSize));
+    if(positionType[1] == SizeType::pixels)
+        itemPosition.setY(position.y());
+    else
+        itemPosition.setY(getYPosition((float)position.y() / 100.0f, screenSize, itemSize));
+    return QRect(itemPosition, itemSize);
+}
+
+void SlideRenderer::setSlide(const PresentationSlide* slide, const QSize& size, qreal devicePixelRatio){
+    clear();
+    m_slide = slide;
+    m_size = size;
+    m_devicePixelRatio = devicePixelRatio;
+    if(!m_slide)
+        return;
+    m_items.reserve(m_slide->Images.size() + m_slide->Texts.size() + 1);
+    if(!m_slide->SlideBackgroundFileName.isEmpty()){
+        SlideDisplayItem background;
+        background.Type = SlideDisplayItem::BackgroundImage;
+        background.Rect = QRect(QPoint(0, 0), size);
+        background.FileName = m_slide->SlideBackgroundFileName;
+        m_items.push_back(background);
+    }
+    else if(m_slide->hasBackgroundColor){
+        m_backgroundColor = QColor(m_slide->SlideBackgroundColor);
+    }
+    for(const PresentationImage& image : m_slide->Images){
+        SlideDisplayItem item;
+        item.Type = SlideDisplayItem::Image;
+        item.Rect = getItemRect(size, image.Position, image.Position_type, image.Size, image.Size_type);
+        item.FileName = image.FileName;
+        item.Text = image.Alt;
+        m_items.push_back(item);
+    }
+    for(const PresentationText& text : m_slide->Texts){
+        SlideDisplayItem item;
+        item.Type = SlideDisplayItem::Text;
+        item.Rect = getItemRect(size, text.Position, text.Position_type, text.Size, text.Size_type);
+        item.Text = text.Text;
+        item.Font.setBold(text.isBold);
+        item.Font.setItalic(text.isItalic);
+        item.Font.setStrikeOut(text.isStrikedOut);
+        item.Font.setUnderline(text.isUnderlined);
+        switch (text.fontSizeType)
+        {
+            case SizeType::points:
+                item.Font.setPixelSize(qMax(1, (int)((float)size.height() / 400.0f * (float)text.fontSize)));
+                break;
+            case SizeType::pixels:
+                item.Font.setPixelSize(qMax(1, text.fontSize));
+                break;
+            default:
+                item.Font.setPixelSize(qMax(1, (int)((float)size.height() / 400.0f * (float)qMax(1, text.fontSize))));
+                break;
+        }
+        item.Color = QColor::fromRgba(text.FontColor);
+        item.Alignment = text.Alignment;
+        m_items.push_back(item);
+    }
+}
+
+void SlideRenderer::clear(){
+    m_slide = nullptr;
+    m_items.clear();
+    m_backgroundColor = QColor::fromRgb(255, 255, 255, 255);
+}
+
+QSize SlideRenderer::imageSize(size_t item) const{
+    return m_items.at(item).Rect.size() * m_devicePixelRatio;
+}
+
+void SlideRenderer::setImage(size_t item, const QImage& image, bool preview){
+    m_items.at(item).Image = image;
+    m_items.at(item).Preview = preview;
+    m_items.at(item).Failed = false;
+}
+
+void SlideRenderer::setImageFailed(size_t item){
+    m_items.at(item).Image = QImage();
+    m_items.at(item).Preview = false;
+    m_items.at(item).Failed = true;
+}
+
+bool SlideRenderer::isComplete() const{
+    for(const SlideDisplayItem& item : m_items){
+        if(item.Type != SlideDisplayItem::Text && (item.Image.isNull() || item.Preview) && !item.Failed)
+            return false;
+    }
+    return true;
+}
+
+void SlideRenderer::loadImages(Presentation* presentation){
+    for(size_t i = 0; i < m_items.size(); i++){
+        if(m_items.at(i).Type == SlideDisplayItem::Text)
+            continue;
+        try{
+            QImage image = presentation->DecodeImage(m_items.at(i).FileName, imageSize(i));
+            if(image.isNull())
+                setImageFailed(i);
+            else
+                setImage(i, image);
+        }
+        catch(const PresentationException& e){
+            printf("[WARNING] Failed to display image: %s. Error: %s.\n", m_items.at(i).FileName.toStdString().c_str(), e.what());
+            setImageFailed(i);
+        }
+    }
+}
+
+void SlideRenderer::requestImages(Presentation* presentation, const ImageRequestToken& token,
+                                  QObject* context, SlideItemCallback itemReady){
+    for(size_t i = 0; i < m_items.size(); i++){
+        if(m_items.at(i).Type == SlideDisplayItem::Text)
+            continue;
+        QString fileName = m_items.at(i).FileName;
+        presentation->RequestImage(fileName, imageSize(i), token, context,
+            [this, i, fileName, itemReady](const QImage& image, const QString& error, bool preview){
+                if(!error.isEmpty()){
+                    printf("[WARNING] Failed to display image: %s. Error: %s.\n", fileName.toStdString().c_str(), error.toStdString().c_str());
+                    setImageFailed(i);
+                }
+                else{
+                    setImage(i, image, preview);
+                }
+                if(itemReady)
+                    itemReady(i);
+            });
+    }
+}
+
+void SlideRenderer::paint(QPainter& painter, const QRect& exposed) const{
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.fillRect(exposed.isNull() ? QRect(QPoint(0, 0), m_size) : exposed, m_backgroundColor);
+    for(const SlideDisplayItem& item : m_items){
+        if(!exposed.isNull() && !item.Rect.intersects(exposed))
+            continue;
+        switch (item.Type)
+        {
+            case SlideDisplayItem::BackgroundImage:
+            case SlideDisplayItem::Image:
+                if(!item.Image.isNull()){
+                    painter.drawImage(item.Rect, item.Image);
+                }
+                else if(item.Failed && !item.Text.isEmpty()){
+                    painter.setFont(QFont());
+                    painter.setPen(QColor::fromRgb(0, 0, 0, 255));
+                    painter.drawText(item.Rect, Qt::AlignCenter, item.Text);
+                }
+                break;
+            case SlideDisplayItem::Text:
+                painter.setFont(item.Font);
+                painter.setPen(item.Color);
+                painter.drawText(item.Rect, item.Alignment | Qt::TextWordWrap, item.Text);
+                break;
+        }
+    }
+}
+
+QImage SlideRenderer::render() const{
+    QImage frame(frameSize(), QImage::Format_ARGB32_Premultiplied);
+    frame.setDevicePixelRatio(m_devicePixelRatio);
+    QPainter painter(&frame);
+    paint(painter);
+    painter.end();
+    return frame;
+}
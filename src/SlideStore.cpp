@@ -0,0 +1,34 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+
+#include <SlideStore.hpp>
+
+QString StringPool::intern(const QString& string){
+    if(string.isEmpty())
+        return QString();
+    QMutexLocker locker(&m_mutex);
+    auto it = m_strings.constFind(string);
+    if(it != m_strings.constEnd())
+        return *it;
+    m_strings.insert(string);
+    return string;
+}
+
+size_t StringPool::size() const{
+    QMutexLocker locker(&m_mutex);
+    return m_strings.size();
+}
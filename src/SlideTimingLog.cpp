@@ -0,0 +1,188 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <SlideTimingLog.hpp>
+#include <algorithm>
+#include <vector>
+
+SlideTimingLog::SlideTimingLog(size_t capacity) : m_capacity(qMax<size_t>(1, capacity)) {
+    m_logTimer.start();
+}
+
+void SlideTimingLog::begin(unsigned int slide){
+    m_current = SlideSwitchTiming();
+    m_current.Slide = slide;
+    m_current.StartedMs = m_logTimer.elapsed();
+    m_tracking = false;
+    m_active = true;
+    m_switchTimer.start();
+}
+
+// Attributes the image requests under token to the current switch. Work done
+// for the token before this call, e.g. by an adopted prefetch, is not counted.
+void SlideTimingLog::trackRequests(const ImageRequestToken& token){
+    if(!m_active)
+        return;
+    collectRequests();
+    m_requests = token;
+    m_tracking = true;
+    const ImageDecoderCounters& counters = m_requests.counters();
+    m_readNs = counters.ReadNs.load();
+    m_decodeNs = counters.DecodeNs.load();
+    m_scaleNs = counters.ScaleNs.load();
+    m_images = counters.Images.load();
+}
+
+void SlideTimingLog::collectRequests(){
+    if(!m_tracking)
+        return;
+    const ImageDecoderCounters& counters = m_requests.counters();
+    qint64 readNs = counters.ReadNs.load(), decodeNs = counters.DecodeNs.load();
+    qint64 scaleNs = counters.ScaleNs.load(), images = counters.Images.load();
+    m_current.ReadMs += (readNs - m_readNs) / 1000000.0;
+    m_current.DecodeMs += (decodeNs - m_decodeNs) / 1000000.0;
+    m_current.ScaleMs += (scaleNs - m_scaleNs) / 1000000.0;
+    m_current.Images += images - m_images;
+    m_readNs = readNs;
+    m_decodeNs = decodeNs;
+    m_scaleNs = scaleNs;
+    m_images = images;
+}
+
+void SlideTimingLog::cancel(){
+    m_active = false;
+    m_tracking = false;
+}
+
+void SlideTimingLog::setCached(bool cached){
+    if(m_active)
+        m_current.Cached = cached;
+}
+
+void SlideTimingLog::addLayout(double ms){
+    if(m_active)
+        m_current.LayoutMs += ms;
+}
+
+void SlideTimingLog::addRender(double ms){
+    if(m_active)
+        m_current.RenderMs += ms;
+}
+
+void SlideTimingLog::setTransition(int frames, double maxFrameMs){
+    if(!m_active)
+        return;
+    m_current.TransitionFrames = frames;
+    m_current.TransitionMaxFrameMs = maxFrameMs;
+}
+
+double SlideTimingLog::elapsedMs() const{
+    return m_switchTimer.nsecsElapsed() / 1000000.0;
+}
+
+bool SlideTimingLog::markPainted(bool complete){
+    if(!m_active)
+        return false;
+    if(m_current.FirstPaintMs < 0)
+        m_current.FirstPaintMs = elapsedMs();
+    if(!complete)
+        return false;
+    m_current.TotalMs = elapsedMs();
+    collectRequests();
+    m_records.push_back(m_current);
+    while(m_records.size() > m_capacity)
+        m_records.pop_front();
+    cancel();
+    return true;
+}
+
+void SlideTimingLog::clear(){
+    cancel();
+    m_records.clear();
+}
+
+QString SlideTimingLog::summary() const{
+    const SlideSwitchTiming* timing = last();
+    if(!timing)
+        return QString("no slide switches yet");
+    std::vector<double> totals;
+    for(const SlideSwitchTiming& record : m_records)
+        totals.push_back(record.TotalMs);
+    std::sort(totals.begin(), totals.end());
+    QString text = QString("slide %1%2\n").arg(timing->Slide + 1).arg(timing->Cached ? " (cached)" : "");
+    text += QString("read %1  decode %2  scale %3 ms (%4 images)\n").arg(timing->ReadMs, 0, 'f', 1)
+            .arg(timing->DecodeMs, 0, 'f', 1).arg(timing->ScaleMs, 0, 'f', 1).arg(timing->Images);
+    text += QString("layout %1  render %2 ms\n").arg(timing->LayoutMs, 0, 'f', 1).arg(timing->RenderMs, 0, 'f', 1);
+    text += QString("first paint %1  total %2 ms\n").arg(timing->FirstPaintMs, 0, 'f', 1).arg(timing->TotalMs, 0, 'f', 1);
+    if(timing->TransitionFrames)
+        text += QString("transition %1 frames, max %2 ms\n").arg(timing->TransitionFrames)
+                .arg(timing->TransitionMaxFrameMs, 0, 'f', 1);
+    text += QString("total p50 %1  max %2 ms over %3 switches").arg(totals[totals.size() / 2], 0, 'f', 1)
+            .arg(totals.back(), 0, 'f', 1).arg(totals.size());
+    return text;
+}
+
+bool SlideTimingLog::exportJson(const QString& path) const{
+    QJsonArray switches;
+    for(const SlideSwitchTiming& record : m_records){
+        QJsonObject object;
+        object["slide"] = (int)record.Slide + 1;
+        object["cached"] = record.Cached;
+        object["startedMs"] = (double)record.StartedMs;
+        object["readMs"] = record.ReadMs;
+        object["decodeMs"] = record.DecodeMs;
+        object["scaleMs"] = record.ScaleMs;
+        object["layoutMs"] = record.LayoutMs;
+        object["renderMs"] = record.RenderMs;
+        object["firstPaintMs"] = record.FirstPaintMs;
+        object["totalMs"] = record.TotalMs;
+        object["images"] = (double)record.Images;
+        object["transitionFrames"] = record.TransitionFrames;
+        object["transitionMaxFrameMs"] = record.TransitionMaxFrameMs;
+        switches.append(object);
+    }
+    QJsonObject root;
+    root["slideSwitches"] = switches;
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
+
+bool SlideTimingLog::exportCsv(const QString& path) const{
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << "slide,cached,started_ms,read_ms,decode_ms,scale_ms,layout_ms,render_ms,first_paint_ms,total_ms,"
+           "images,transition_frames,transition_max_frame_ms\n";
+    for(const SlideSwitchTiming& record : m_records){
+        out << record.Slide + 1 << ',' << (record.Cached ? 1 : 0) << ',' << record.StartedMs << ','
+            << record.ReadMs << ',' << record.DecodeMs << ',' << record.ScaleMs << ','
+            << record.LayoutMs << ',' << record.RenderMs << ',' << record.FirstPaintMs << ','
+            << record.TotalMs << ',' << record.Images << ',' << record.TransitionFrames << ','
+            << record.TransitionMaxFrameMs << '\n';
+    }
+    out.flush();
+    return file.commit();
+}
+
+bool SlideTimingLog::exportFile(const QString& path) const{
+    if(path.endsWith(".csv", Qt::CaseInsensitive))
+        return exportCsv(path);
+    return exportJson(path);
+}
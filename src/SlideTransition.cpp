@@ -0,0 +1,170 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <SlideTransition.hpp>
+#include <string.h>
+#include <cmath>
+
+bool SlideTransition::canComposite(const QImage& from, const QImage& to){
+    if(from.isNull() || to.isNull() || from.size() != to.size() || from.format() != to.format())
+        return false;
+    return to.format() == QImage::Format_ARGB32_Premultiplied || to.format() == QImage::Format_RGB32;
+}
+
+bool SlideTransition::start(const QImage& from, const QImage& to, bool reverse){
+    reset();
+    if(m_type == cut || m_duration <= 0 || !canComposite(from, to))
+        return false;
+    m_from = from;
+    m_to = to;
+    m_reverse = reverse;
+    // The output buffer is reused between transitions unless it is the frame
+    // we are transitioning away from.
+    if(m_frame.size() != to.size() || m_frame.format() != to.format() || m_frame.constBits() == from.constBits())
+        m_frame = QImage(to.size(), to.format());
+    if(m_frame.isNull()){
+        stop();
+        return false;
+    }
+    m_frame.setDevicePixelRatio(to.devicePixelRatio());
+    composite(m_type, m_from, m_to, 0.0, m_reverse, &m_frame);
+    m_interval = TargetInterval;
+    m_stats.Interval = m_interval;
+    m_running = true;
+    m_clock.start();
+    return true;
+}
+
+bool SlideTransition::advance(){
+    if(!m_running)
+        return false;
+    qint64 elapsed = m_clock.elapsed();
+    if(elapsed >= m_duration){
+        stop();
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    composite(m_type, m_from, m_to, (qreal)elapsed / m_duration, m_reverse, &m_frame);
+    double frameMs = timer.nsecsElapsed() / 1000000.0;
+    m_stats.Frames++;
+    m_stats.LastFrameMs = frameMs;
+    m_stats.MaxFrameMs = qMax(m_stats.MaxFrameMs, frameMs);
+    m_stats.TotalFrameMs += frameMs;
+    // Leave room for painting the frame; back off towards the target rate
+    // again once frames get cheap.
+    if(frameMs * 2 > m_interval)
+        m_interval = qMin(MaxInterval, (int)std::ceil(frameMs * 2));
+    else if(frameMs * 4 < m_interval)
+        m_interval = qMax(TargetInterval, m_interval / 2);
+    m_stats.Interval = m_interval;
+    return true;
+}
+
+void SlideTransition::stop(){
+    m_running = false;
+    m_from = QImage();
+    m_to = QImage();
+}
+
+void SlideTransition::reset(){
+    stop();
+    m_stats = SlideTransitionStats();
+}
+
+void SlideTransition::composite(SlideTransitionType type, const QImage& from, const QImage& to,
+                                qreal progress, bool reverse, QImage* out){
+    progress = qBound<qreal>(0.0, progress, 1.0);
+    int width = to.width();
+    switch(type){
+    case crossfade:
+        crossfadeFrames(from, to, (int)std::lround(progress * 256), out);
+        break;
+    case push:
+        pushFrames(from, to, (int)std::lround(QEasingCurve(QEasingCurve::InOutQuad).valueForProgress(progress) * width),
+                   reverse, out);
+        break;
+    case wipe:
+        wipeFrames(from, to, (int)std::lround(QEasingCurve(QEasingCurve::InOutQuad).valueForProgress(progress) * width),
+                   reverse, out);
+        break;
+    default:
+        wipeFrames(from, to, progress < 1.0 ? 0 : width, reverse, out);
+        break;
+    }
+}
+
+void SlideTransition::crossfadeFrames(const QImage& from, const QImage& to, int alpha, QImage* out){
+    // Premultiplied pixels blend channel-wise, two channels per 32-bit lane.
+    // The weights sum to 256, so neither lane can overflow into the next one.
+    const quint32 inverse = 256 - alpha;
+    const int width = to.width();
+    for(int y = 0; y < to.height(); y++){
+        const quint32* a = (const quint32*)from.constScanLine(y);
+        const quint32* b = (const quint32*)to.constScanLine(y);
+        quint32* dst = (quint32*)out->scanLine(y);
+        for(int x = 0; x < width; x++){
+            quint32 p = a[x], q = b[x];
+            quint32 rb = (p & 0x00FF00FF) * inverse + (q & 0x00FF00FF) * alpha;
+            quint32 ag = ((p >> 8) & 0x00FF00FF) * inverse + ((q >> 8) & 0x00FF00FF) * alpha;
+            dst[x] = ((rb >> 8) & 0x00FF00FF) | (ag & 0xFF00FF00);
+        }
+    }
+}
+
+void SlideTransition::pushFrames(const QImage& from, const QImage& to, int offset, bool reverse, QImage* out){
+    const int width = to.width();
+    offset = qBound(0, offset, width);
+    for(int y = 0; y < to.height(); y++){
+        const quint32* a = (const quint32*)from.constScanLine(y);
+        const quint32* b = (const quint32*)to.constScanLine(y);
+        quint32* dst = (quint32*)out->scanLine(y);
+        if(!reverse){
+            memcpy(dst, a + offset, (width - offset) * sizeof(quint32));
+            memcpy(dst + width - offset, b, offset * sizeof(quint32));
+        }
+        else{
+            memcpy(dst, b + width - offset, offset * sizeof(quint32));
+            memcpy(dst + offset, a, (width - offset) * sizeof(quint32));
+        }
+    }
+}
+
+void SlideTransition::wipeFrames(const QImage& from, const QImage& to, int edge, bool reverse, QImage* out){
+    const int width = to.width();
+    edge = qBound(0, edge, width);
+    int split = reverse ? width - edge : edge;
+    const QImage& left = reverse ? from : to;
+    const QImage& right = reverse ? to : from;
+    for(int y = 0; y < to.height(); y++){
+        quint32* dst = (quint32*)out->scanLine(y);
+        memcpy(dst, left.constScanLine(y), split * sizeof(quint32));
+        memcpy(dst + split, (const quint32*)right.constScanLine(y) + split, (width - split) * sizeof(quint32));
+    }
+}
+
+SlideTransitionType SlideTransition::typeFromString(const QString& name, SlideTransitionType fallback){
+    QString type = name.trimmed().toLower();
+    if(type == "cut" || type == "none")
+        return cut;
+    if(type == "crossfade" || type == "fade")
+        return crossfade;
+    if(type == "push")
+        return push;
+    if(type == "wipe")
+        return wipe;
+    return fallback;
+}
@@ -0,0 +1,147 @@
+// This file is part of Simple Press 2
+// Copyright (C) 2022 Karol Maksymowicz
+//
+// Simple Press 2 is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, If not,
+// see <https://www.gnu.org/licenses/>.
+#include <Trace.hpp>
+#include <memory>
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+
+struct TraceEvent
+{
+public:
+    const char* Name;
+    const char* Category;
+    qint64 Begin;
+    qint64 Duration;
+};
+
+// One buffer per thread, so recording only ever takes an uncontended lock.
+// Buffers live until exit because threads keep a pointer to theirs.
+struct TraceThreadBuffer
+{
+public:
+    QMutex Mutex;
+    std::vector<TraceEvent> Events;
+    int Id = 0;
+    QString Name;
+};
+
+static QMutex s_traceMutex;
+static QString s_tracePath;
+static QElapsedTimer s_traceClock;
+static std::vector<std::unique_ptr<TraceThreadBuffer>> s_traceBuffers;
+static thread_local TraceThreadBuffer* t_traceBuffer = nullptr;
+
+std::atomic<bool> Trace::s_enabled{false};
+
+bool Trace::configure(int argc, char** argv){
+    QString path = qEnvironmentVariable("SIMPLEPRESS_TRACE");
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "--trace") && i + 1 < argc)
+            path = QString::fromLocal8Bit(argv[i + 1]);
+        else if(!strncmp(argv[i], "--trace=", 8))
+            path = QString::fromLocal8Bit(argv[i] + 8);
+    }
+    if(path.isEmpty())
+        return false;
+    return start(path);
+}
+
+bool Trace::start(const QString& path){
+    QMutexLocker locker(&s_traceMutex);
+    if(path.isEmpty())
+        return false;
+    s_tracePath = path;
+    for(const std::unique_ptr<TraceThreadBuffer>& buffer : s_traceBuffers){
+        QMutexLocker bufferLocker(&buffer->Mutex);
+        buffer->Events.clear();
+    }
+    s_traceClock.start();
+    s_enabled.store(true);
+    return true;
+}
+
+qint64 Trace::now(){
+    return s_traceClock.nsecsElapsed();
+}
+
+void Trace::record(const char* name, const char* category, qint64 begin, qint64 duration){
+    if(!t_traceBuffer){
+        QMutexLocker locker(&s_traceMutex);
+        TraceThreadBuffer* buffer = new TraceThreadBuffer;
+        buffer->Id = (int)s_traceBuffers.size() + 1;
+        QThread* thread = QThread::currentThread();
+        buffer->Name = thread ? thread->objectName() : QString();
+        if(thread && QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+            buffer->Name = "main";
+        else if(buffer->Name.isEmpty())
+            buffer->Name = QString("thread %1").arg(buffer->Id);
+        s_traceBuffers.emplace_back(buffer);
+        t_traceBuffer = buffer;
+    }
+    QMutexLocker locker(&t_traceBuffer->Mutex);
+    t_traceBuffer->Events.push_back({ name, category, begin, duration });
+}
+
+static void AppendEscaped(QByteArray* out, const char* text){
+    for(; *text; text++){
+        if(*text == '"' || *text == '\\')
+            out->append('\\');
+        out->append(*text);
+    }
+}
+
+bool Trace::stop(){
+    if(!s_enabled.exchange(false))
+        return false;
+    QMutexLocker locker(&s_traceMutex);
+    qint64 pid = QCoreApplication::applicationPid();
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for(const std::unique_ptr<TraceThreadBuffer>& buffer : s_traceBuffers){
+        QMutexLocker bufferLocker(&buffer->Mutex);
+        if(!first)
+            json += ",\n";
+        first = false;
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(pid) +
+                ",\"tid\":" + QByteArray::number(buffer->Id) + ",\"args\":{\"name\":\"";
+        AppendEscaped(&json, buffer->Name.toUtf8().constData());
+        json += "\"}}";
+        for(const TraceEvent& event : buffer->Events){
+            json += ",\n{\"name\":\"";
+            AppendEscaped(&json, event.Name);
+            json += "\",\"cat\":\"";
+            AppendEscaped(&json, event.Category);
+            json += "\",\"ph\":\"X\",\"ts\":" + QByteArray::number(event.Begin / 1000.0, 'f', 3) +
+                    ",\"dur\":" + QByteArray::number(event.Duration / 1000.0, 'f', 3) +
+                    ",\"pid\":" + QByteArray::number(pid) + ",\"tid\":" + QByteArray::number(buffer->Id) + "}";
+        }
+        buffer->Events.clear();
+    }
+    json += "\n]}\n";
+    QSaveFile file(s_tracePath);
+    if(!file.open(QIODevice::WriteOnly)){
+        printf("[WARNING] Failed to write trace file %s.\n", s_tracePath.toStdString().c_str());
+        return false;
+    }
+    file.write(json);
+    if(!file.commit()){
+        printf("[WARNING] Failed to write trace file %s.\n", s_tracePath.toStdString().c_str());
+        return false;
+    }
+    return true;
+}
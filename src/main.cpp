@@ -16,8 +16,22 @@
 // see <https://www.gnu.org/licenses/>.
 
 #include <Application.hpp>
+#include <BatchRenderer.hpp>
+#include <Trace.hpp>
 
 int main(int argc, char* argv[]){
-    Application app(argc, argv);
-    return app.Execute();
+    Trace::configure(argc, argv);
+    int result;
+    if(BatchRenderer::IsBatchInvocation(argc, argv)){
+        if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        QGuiApplication app(argc, argv);
+        result = BatchRenderer::Run(app.arguments());
+    }
+    else{
+        Application app(argc, argv);
+        result = app.Execute();
+    }
+    Trace::stop();
+    return result;
 }